@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <iostream>
+#include <string_view>
 #include <time.h>
 
 #include "CSVparser.hpp"
@@ -71,6 +72,7 @@ public:
     void Prepend(Bid bid);
     void PrintList();
     void Remove(string bidId);
+    const Bid* Find(string_view bidId);
     Bid Search(string bidId);
     int Size();
 };
@@ -207,11 +209,13 @@ void LinkedList::Remove(string bidId) {
 }
 
 /**
- * Search for the specified bidId
+ * Find the bid with the specified bidId without copying it
  *
  * @param bidId The bid id to search for
+ * @return The bid in the list, nullptr if not found. It stays valid
+ *         until the bid is removed.
  */
-Bid LinkedList::Search(string bidId) {
+const Bid* LinkedList::Find(string_view bidId) {
     // FIXME (6): Implement search logic
 
     // start at the head of the list
@@ -221,15 +225,28 @@ Bid LinkedList::Search(string bidId) {
     while (currNode != nullptr) {
         // if the current node matches, return it
         if (currNode->bid.bidId == bidId) {
-            return currNode->bid;
+            return &currNode->bid;
         }
         // else current node is equal to next node
         else {
             currNode = currNode->next;
         }
     }
+    return nullptr;
+}
+
+/**
+ * Search for the specified bidId
+ *
+ * @param bidId The bid id to search for
+ * @return A copy of the bid, empty if not found
+ */
+Bid LinkedList::Search(string bidId) {
+    const Bid* bid = Find(bidId);
+    if (bid != nullptr) {
+        return *bid;
+    }
     Bid tempBid;
-    tempBid.bidId = "";
     return tempBid;
 }
 
@@ -249,7 +266,7 @@ int LinkedList::Size() {
  *
  * @param bid struct containing the bid info
  */
-void displayBid(Bid bid) {
+void displayBid(const Bid& bid) {
     cout << bid.bidId << ": " << bid.title << " | " << bid.amount
          << " | " << bid.fund << endl;
     return;
@@ -356,6 +373,7 @@ int main(int argc, char* argv[]) {
     LinkedList bidList;
 
     Bid bid;
+    const Bid* found;
 
     int choice = 0;
     while (choice != 9) {
@@ -398,12 +416,12 @@ int main(int argc, char* argv[]) {
         case 4:
             ticks = clock();
 
-            bid = bidList.Search(bidKey);
+            found = bidList.Find(bidKey);
 
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
 
-            if (!bid.bidId.empty()) {
-                displayBid(bid);
+            if (found != nullptr) {
+                displayBid(*found);
             } else {
             	cout << "Bid Id " << bidKey << " not found." << endl;
             }
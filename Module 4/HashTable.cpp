@@ -7,12 +7,53 @@
 //============================================================================
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <climits>
+#include <cstdint>
+#include <cstring> // memcpy
+#include <fstream>
 #include <iostream>
-#include <string> // atoi
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <time.h>
+#include <unordered_map>
 #include "CSVparser.hpp"
 
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// set HASHTABLE_STATS to 0 to compile the operation counters out
+#ifndef HASHTABLE_STATS
+#define HASHTABLE_STATS 1
+#endif
+
+#if HASHTABLE_STATS
+#define COUNT_STAT(counter) if (collectStats) { counters.counter++; }
+#else
+#define COUNT_STAT(counter)
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASHTABLE_SSE2 1
+#define PREFETCH(address) _mm_prefetch((const char*) (address), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address)
+#endif
+
 using namespace std;
 
 //============================================================================
@@ -21,9 +62,69 @@ using namespace std;
 
 const unsigned int DEFAULT_SIZE = 179;
 
+// grow the table once the average chain is longer than this
+const double DEFAULT_MAX_LOAD_FACTOR = 1.0;
+
+// shrinking is off by default (0.0), set a min load factor to enable it
+const double DEFAULT_MIN_LOAD_FACTOR = 0.0;
+
+// old buckets moved over per operation during an incremental resize
+const unsigned int MIGRATE_BUCKETS = 4;
+
+// key of a removed node that is still linked into its chain
+const unsigned int TOMBSTONE = UINT_MAX - 1;
+
+// start compacting once tombstones pass this fraction of the live bids
+const double MAX_TOMBSTONE_RATIO = 0.25;
+
+// buckets swept per operation while compacting
+const unsigned int COMPACT_BUCKETS = 4;
+
+// slots checked at once by the flat table, one SSE2 register of control bytes
+const unsigned int GROUP_WIDTH = 16;
+
+// independently locked shards in the concurrent table, a power of two
+const unsigned int DEFAULT_SHARDS = 64;
+
+// lookups hashed and prefetched together by SearchBatch
+const unsigned int BATCH_GROUP = 16;
+
+// most threads that can read a lock-free table at the same time
+const unsigned int MAX_READERS = 256;
+
+// removed nodes collected before the lock-free table tries to free them
+const unsigned int RECLAIM_BATCH = 64;
+
+// average keys per bucket when building a perfect hash
+const unsigned int PERFECT_BUCKET_KEYS = 4;
+
 // forward declarations
 double strToDouble(string str, char ch);
 
+// define a structure to hold a snapshot of how a table is laid out
+struct TableStats {
+    unsigned int bids = 0;
+    unsigned int buckets = 0;     // buckets, or slots for open addressing
+    unsigned int usedBuckets = 0;
+    unsigned int tombstones = 0;
+    unsigned int maxChain = 0;    // longest chain or probe sequence
+    double loadFactor = 0.0;
+    size_t bytesUsed = 0;
+    vector<unsigned int> chainHistogram; // buckets (or bids) per chain (or probe) length
+
+    // operation counters since the last reset
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t keyCompares = 0;
+    uint64_t inserts = 0;
+    uint64_t removes = 0;
+};
+
+// hash policy used by the table, turns the full key into 64 bits
+typedef uint64_t (*HashFunction)(string_view key);
+uint64_t wyHash(string_view key);
+uint64_t fnv1aHash(string_view key);
+
 // define a structure to hold bid information
 struct Bid {
     string bidId; // unique identifier
@@ -35,6 +136,206 @@ struct Bid {
     }
 };
 
+//============================================================================
+// Hash functions
+//============================================================================
+
+/**
+ * Multiply two 64 bit numbers and fold the 128 bit product back into
+ * 64 bits. Written with 32 bit halves so it builds on any compiler.
+ */
+static uint64_t foldedMultiply(uint64_t a, uint64_t b) {
+    uint64_t aLow = a & 0xffffffff, aHigh = a >> 32;
+    uint64_t bLow = b & 0xffffffff, bHigh = b >> 32;
+
+    uint64_t lowLow = aLow * bLow;
+    uint64_t lowHigh = aLow * bHigh;
+    uint64_t highLow = aHigh * bLow;
+    uint64_t highHigh = aHigh * bHigh;
+
+    uint64_t middle = (lowLow >> 32) + (lowHigh & 0xffffffff) + (highLow & 0xffffffff);
+    uint64_t low = (lowLow & 0xffffffff) | (middle << 32);
+    uint64_t high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+    return low ^ high;
+}
+
+/**
+ * Hash every byte of a key, eight at a time, in the style of wyhash.
+ * This is the default policy of the hash table.
+ *
+ * @param key The key to hash
+ * @return 64 bit hash of the key
+ */
+uint64_t wyHash(string_view key) {
+    const unsigned char* bytes = (const unsigned char*) key.data();
+    size_t length = key.size();
+    uint64_t seed = 0xa0761d6478bd642fULL ^ length;
+
+    // mix in whole 8 byte words
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        seed = foldedMultiply(word ^ 0xe7037ed1a0b428dbULL, seed ^ 0x8ebc6af09c88c6e3ULL);
+        bytes += 8;
+        length -= 8;
+    }
+
+    // then the last 0-7 bytes
+    uint64_t tail = 0;
+    memcpy(&tail, bytes, length);
+    return foldedMultiply(seed ^ 0x589965cc75374cc3ULL, tail ^ 0x1d8e4e27c47d124fULL);
+}
+
+/**
+ * Simple byte at a time FNV-1a hash, kept as an alternative policy
+ *
+ * @param key The key to hash
+ * @return 64 bit hash of the key
+ */
+uint64_t fnv1aHash(string_view key) {
+    uint64_t hashValue = 0xcbf29ce484222325ULL;
+    for (unsigned char c : key) {
+        hashValue ^= c;
+        hashValue *= 0x100000001b3ULL;
+    }
+    return hashValue;
+}
+
+//============================================================================
+// Fund Index class definition
+//============================================================================
+
+/**
+ * Secondary index from a fund to the bids paid from it, kept by a table
+ * once its Funds() is first called. Each fund has a posting list with one
+ * entry per stored bid, so listing or counting a fund costs time
+ * proportional to its bids instead of a scan of the whole table. An entry
+ * points at the bid's record, which remembers the entry's place in the
+ * list, so a remove moves the last entry into the hole in O(1). The bids
+ * themselves stay in the table.
+ */
+class FundIndex {
+
+private:
+    struct Posting {
+        uint32_t fund; // the fund's list in lists
+        uint32_t position; // the entry's place in that list
+    };
+
+    // one record per stored bid, an id stored twice has two
+    typedef unordered_multimap<string, Posting> PostingMap;
+
+    PostingMap postings;
+    unordered_map<string, uint32_t> fundNumbers;
+    vector<vector<PostingMap::value_type*>> lists;
+
+    // the concurrent engines update the index from many threads
+    mutex lock;
+
+public:
+    void Insert(const Bid& bid);
+    void Remove(const Bid& bid);
+    unsigned int Count(string fund);
+    vector<string> BidIds(string fund);
+    vector<string> Funds();
+    void Clear();
+};
+
+/**
+ * Add a bid to the posting list of its fund
+ *
+ * @param bid The bid just inserted into the table
+ */
+void FundIndex::Insert(const Bid& bid) {
+    lock_guard<mutex> guard(lock);
+    auto number = fundNumbers.find(bid.fund);
+    if (number == fundNumbers.end()) {
+        number = fundNumbers.emplace(bid.fund, (uint32_t) lists.size()).first;
+        lists.emplace_back();
+    }
+    vector<PostingMap::value_type*>& list = lists[number->second];
+    auto record = postings.emplace(bid.bidId, Posting { number->second, (uint32_t) list.size() });
+    list.push_back(&*record);
+}
+
+/**
+ * Take a bid out of the posting list of its fund
+ *
+ * @param bid The bid just removed from the table
+ */
+void FundIndex::Remove(const Bid& bid) {
+    lock_guard<mutex> guard(lock);
+    auto number = fundNumbers.find(bid.fund);
+    if (number == fundNumbers.end()) {
+        return;
+    }
+
+    // an id stored twice may be paid from two funds, drop the removed one
+    auto range = postings.equal_range(bid.bidId);
+    for (auto record = range.first; record != range.second; ++record) {
+        Posting posting = record->second;
+        if (posting.fund != number->second) {
+            continue;
+        }
+        vector<PostingMap::value_type*>& list = lists[posting.fund];
+        list[posting.position] = list.back();
+        list[posting.position]->second.position = posting.position;
+        list.pop_back();
+        postings.erase(record);
+        return;
+    }
+}
+
+/**
+ * Returns the number of bids paid from a fund
+ */
+unsigned int FundIndex::Count(string fund) {
+    lock_guard<mutex> guard(lock);
+    auto number = fundNumbers.find(fund);
+    return number == fundNumbers.end() ? 0 : (unsigned int) lists[number->second].size();
+}
+
+/**
+ * Returns the ids of the bids paid from a fund, in no particular order
+ */
+vector<string> FundIndex::BidIds(string fund) {
+    lock_guard<mutex> guard(lock);
+    vector<string> bidIds;
+    auto number = fundNumbers.find(fund);
+    if (number != fundNumbers.end()) {
+        bidIds.reserve(lists[number->second].size());
+        for (PostingMap::value_type* record : lists[number->second]) {
+            bidIds.push_back(record->first);
+        }
+    }
+    return bidIds;
+}
+
+/**
+ * Returns every fund with at least one bid, sorted by name
+ */
+vector<string> FundIndex::Funds() {
+    lock_guard<mutex> guard(lock);
+    vector<string> funds;
+    for (auto& number : fundNumbers) {
+        if (!lists[number.second].empty()) {
+            funds.push_back(number.first);
+        }
+    }
+    sort(funds.begin(), funds.end());
+    return funds;
+}
+
+/**
+ * Forget every fund
+ */
+void FundIndex::Clear() {
+    lock_guard<mutex> guard(lock);
+    postings.clear();
+    fundNumbers.clear();
+    lists.clear();
+}
+
 //============================================================================
 // Hash Table class definition
 //============================================================================
@@ -72,177 +373,3129 @@ private:
     vector<Node> nodes;
 
     unsigned int tableSize = DEFAULT_SIZE;
+    unsigned int size = 0; // number of bids currently stored
+
+    double maxLoadFactor = DEFAULT_MAX_LOAD_FACTOR;
+    double minLoadFactor = DEFAULT_MIN_LOAD_FACTOR;
 
-    unsigned int hash(int key);
+    // previous table kept alongside nodes while an incremental resize runs
+    vector<Node> oldNodes;
+    unsigned int oldTableSize = 0;
+    unsigned int migrateIndex = 0; // next old bucket to move over
+    bool incrementalRehash = false;
+
+    // removed nodes waiting for compaction to unlink them
+    unsigned int tombstones = 0;
+    unsigned int compactIndex = 0; // next bucket to sweep
+    bool compacting = false;
+
+    unsigned int hash(string key);
+    void rehash(unsigned int newSize);
+    void migrate(unsigned int buckets);
+    void moveBucket(Node* bucket);
+    void compact(unsigned int buckets);
+    void compactBucket(Node* bucket);
+    Node* findNode(vector<Node>& table, unsigned int key, string_view bidId);
+    Node* removeNode(vector<Node>& table, unsigned int key, string bidId);
+
+protected:
+    HashFunction hashFunction = wyHash;
+
+    // operation counters, only the counting fields of TableStats are used
+    TableStats counters;
+    bool collectStats = true;
+
+    // built by Funds(), then kept in step by Insert and Remove
+    FundIndex* funds = nullptr;
+
+    static size_t bidBytes(const Bid& bid);
+
+    static unsigned int bucketFor(uint64_t hashValue, unsigned int size);
+    static unsigned int nextPrime(unsigned int n);
+
+    // for engines that keep their own storage instead of buckets
+    HashTable(HashFunction function);
 
 public:
     HashTable();
     HashTable(unsigned int size);
     virtual ~HashTable();
-    void Insert(Bid bid);
-    void PrintAll();
-    void Remove(string bidId);
-    Bid Search(string bidId);
+    virtual void Insert(Bid bid);
+    virtual void PrintAll();
+    virtual void Remove(string bidId);
+    virtual const Bid* Find(string_view bidId);
+    virtual Bid Search(string bidId);
+    virtual void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    virtual vector<Bid> GetAllBids();
+    bool WriteIndex(string path);
+    virtual FundIndex& Funds();
+    virtual TableStats GetStats();
+    void ResetCounters();
+    void SetMaxLoadFactor(double loadFactor);
+    void SetMinLoadFactor(double loadFactor);
+    virtual double LoadFactor();
+    virtual unsigned int Size();
+    virtual unsigned int Capacity();
+    void SetIncrementalRehash(bool incremental);
+    void SetCollectStats(bool collect);
+    bool IsRehashing();
+    unsigned int Tombstones();
+    virtual void SetHashFunction(HashFunction function);
+};
+
+/**
+ * Default constructor
+ */
+HashTable::HashTable() {
+    // FIXME (1): Initialize the structures used to hold bids
+    // Initalize node structure by resizing tableSize
+    nodes.resize(DEFAULT_SIZE); // Default size if no size is given
+}
+
+/**
+ * Constructor for specifying size of the table
+ * Use to improve efficiency of hashing algorithm
+ * by reducing collisions without wasting memory.
+ */
+HashTable::HashTable(unsigned int size) {
+    // invoke local tableSize to size with this->
+    // resize nodes size
+    this->tableSize = size;
+    nodes.resize(size);
+}
+
+/**
+ * Constructor used by other engines, no buckets are allocated
+ */
+HashTable::HashTable(HashFunction function) {
+    tableSize = 0;
+    hashFunction = function;
+}
+
+
+/**
+ * Destructor
+ */
+HashTable::~HashTable() {
+    // FIXME (2): Implement logic to free storage when class is destroyed
+    // the bucket heads live in the vector, only the chained nodes were new'd
+    for (vector<Node>* table : { &nodes, &oldNodes }) {
+        for (auto i = table->begin(); i != table->end(); i++) {
+            Node* tempNode = i->next;
+            while (tempNode != nullptr) {
+                Node* nextNode = tempNode->next;
+                delete tempNode;
+                tempNode = nextNode;
+            }
+        }
+    }
+    delete funds;
+}
+
+/**
+ * Calculate the bucket of a given key in the current table.
+ * Every byte of the key is hashed so ids that are not plain
+ * numbers, or that only differ by leading zeros, still spread out.
+ *
+ * @param key The key to hash
+ * @return The calculated hash
+ */
+unsigned int HashTable::hash(string key) {
+    // FIXME (3): Implement logic to calculate a hash value
+    return bucketFor(hashFunction(key), tableSize);
+}
+
+/**
+ * Map a 64 bit hash onto size buckets (the old table during a resize).
+ * Multiplying the top 32 bits by size and keeping the high half
+ * (Lemire's reduction) avoids a division on every lookup.
+ *
+ * @param hashValue The full hash of a key
+ * @param size The number of buckets to hash into
+ * @return The bucket index
+ */
+unsigned int HashTable::bucketFor(uint64_t hashValue, unsigned int size) {
+    return (unsigned int) (((hashValue >> 32) * size) >> 32);
+}
+
+/**
+ * Find the smallest prime number that is greater than or equal to n
+ *
+ * @param n The lower bound
+ * @return The next prime
+ */
+unsigned int HashTable::nextPrime(unsigned int n) {
+    if (n <= 2) {
+        return 2;
+    }
+    // only odd numbers can be prime from here on
+    if (n % 2 == 0) {
+        n++;
+    }
+    while (true) {
+        bool isPrime = true;
+        for (unsigned int d = 3; (unsigned long long) d * d <= n; d += 2) {
+            if (n % d == 0) {
+                isPrime = false;
+                break;
+            }
+        }
+        if (isPrime) {
+            return n;
+        }
+        n += 2;
+    }
+}
+
+/**
+ * Start moving every bid into a new table with newSize buckets.
+ * In incremental mode the old table is kept and drained a few
+ * buckets at a time by later operations, otherwise it is drained
+ * right away.
+ *
+ * @param newSize The number of buckets in the new table
+ */
+void HashTable::rehash(unsigned int newSize) {
+    // a resize still in progress has to finish before starting another
+    migrate(oldTableSize);
+
+    // the current buckets become the old table
+    oldNodes.swap(nodes);
+    nodes.assign(newSize, Node());
+    oldTableSize = tableSize;
+    tableSize = newSize;
+    migrateIndex = 0;
+
+    // the new table starts without tombstones, old ones are dropped as they move
+    compacting = false;
+
+    if (!incrementalRehash) {
+        migrate(oldTableSize);
+    }
+}
+
+/**
+ * Move up to the given number of old buckets into the new table,
+ * releasing the old table once all of it has been moved.
+ *
+ * @param buckets The most old buckets to move
+ */
+void HashTable::migrate(unsigned int buckets) {
+    while (buckets > 0 && migrateIndex < oldTableSize) {
+        moveBucket(&(oldNodes.at(migrateIndex)));
+        migrateIndex++;
+        buckets--;
+    }
+
+    // done resizing, drop the old table
+    if (oldTableSize > 0 && migrateIndex >= oldTableSize) {
+        vector<Node>().swap(oldNodes);
+        oldTableSize = 0;
+        migrateIndex = 0;
+    }
+}
+
+/**
+ * Move every bid in an old bucket into the new table.
+ * Chained nodes are relinked so no bid is copied twice.
+ *
+ * @param bucket The old bucket to empty
+ */
+void HashTable::moveBucket(Node* bucket) {
+    // bucket never used, nothing to move
+    if (bucket->key == UINT_MAX) {
+        return;
+    }
+
+    // the bucket head is stored by value so it must be copied over,
+    // unless it was removed in which case it is simply dropped
+    Node* chain = bucket->next;
+    if (bucket->key == TOMBSTONE) {
+        tombstones--;
+    }
+    else {
+        unsigned key = hash(bucket->bid.bidId);
+        Node* head = &(nodes.at(key));
+        if (head->key == UINT_MAX || head->key == TOMBSTONE) {
+            if (head->key == TOMBSTONE) {
+                tombstones--;
+            }
+            head->key = key;
+            head->bid = bucket->bid;
+        }
+        else {
+            Node* newNode = new Node(bucket->bid, key);
+            newNode->next = head->next;
+            head->next = newNode;
+        }
+    }
+
+    // chained nodes get relinked into their new bucket, removed ones freed
+    while (chain != nullptr) {
+        Node* nextNode = chain->next;
+        if (chain->key == TOMBSTONE) {
+            tombstones--;
+            delete chain;
+            chain = nextNode;
+            continue;
+        }
+
+        unsigned key = hash(chain->bid.bidId);
+        Node* head = &(nodes.at(key));
+        if (head->key == UINT_MAX || head->key == TOMBSTONE) {
+            if (head->key == TOMBSTONE) {
+                tombstones--;
+            }
+            head->key = key;
+            head->bid = chain->bid;
+            delete chain;
+        }
+        else {
+            chain->key = key;
+            chain->next = head->next;
+            head->next = chain;
+        }
+        chain = nextNode;
+    }
+
+    // leave the old bucket empty so it is never freed or searched twice
+    *bucket = Node();
+}
+
+/**
+ * Sweep up to the given number of buckets, unlinking tombstones.
+ * A sweep starts once tombstones pass MAX_TOMBSTONE_RATIO of the live
+ * bids and runs a few buckets per operation until it covers the table.
+ *
+ * @param buckets The most buckets to sweep
+ */
+void HashTable::compact(unsigned int buckets) {
+    if (!compacting && tombstones > 0 && tombstones > size * MAX_TOMBSTONE_RATIO) {
+        compacting = true;
+        compactIndex = 0;
+    }
+
+    while (compacting && buckets > 0) {
+        if (compactIndex >= tableSize) {
+            compacting = false;
+            break;
+        }
+        compactBucket(&(nodes.at(compactIndex)));
+        compactIndex++;
+        buckets--;
+    }
+}
+
+/**
+ * Unlink and free every tombstone in one bucket
+ *
+ * @param bucket The bucket to clean up
+ */
+void HashTable::compactBucket(Node* bucket) {
+    if (bucket->key == UINT_MAX) {
+        return;
+    }
+
+    // drop tombstones from the chain first
+    Node* node = bucket;
+    while (node->next != nullptr) {
+        if (node->next->key == TOMBSTONE) {
+            Node* tempNode = node->next;
+            node->next = tempNode->next;
+            delete tempNode;
+            tombstones--;
+        }
+        else {
+            node = node->next;
+        }
+    }
+
+    // then refill a removed head from the chain, or empty it
+    if (bucket->key == TOMBSTONE) {
+        tombstones--;
+        Node* nextNode = bucket->next;
+        if (nextNode == nullptr) {
+            *bucket = Node();
+        }
+        else {
+            bucket->key = nextNode->key;
+            bucket->bid = nextNode->bid;
+            bucket->next = nextNode->next;
+            delete nextNode;
+        }
+    }
+}
+
+/**
+ * Find the node holding bidId in the given bucket of a table
+ *
+ * @param table The buckets to look in
+ * @param key The bucket the bid hashes to
+ * @param bidId The bid id to search for
+ * @return The matching node or nullptr
+ */
+HashTable::Node* HashTable::findNode(vector<Node>& table, unsigned int key, string_view bidId) {
+    Node* node = &(table.at(key));
+
+    // if no entry found for the key
+    if (node->key == UINT_MAX) {
+        return nullptr;
+    }
+    // while node not equal to nullptr
+    while (node != nullptr) {
+        // if the current node matches, and was not removed, return it
+        if (node->key != TOMBSTONE) {
+            COUNT_STAT(keyCompares);
+            if (node->bid.bidId.compare(bidId) == 0) {
+                return node;
+            }
+        }
+        //node is equal to next node
+        node = node->next;
+    }
+    return nullptr;
+}
+
+/**
+ * Remove the node holding bidId from the given bucket of a table
+ * by turning it into a tombstone
+ *
+ * @param table The buckets to look in
+ * @param key The bucket the bid hashes to
+ * @param bidId The bid id to remove
+ * @return The node removed, its bid is kept until compaction, nullptr
+ *         if there was none
+ */
+HashTable::Node* HashTable::removeNode(vector<Node>& table, unsigned int key, string bidId) {
+    Node* node = findNode(table, key, bidId);
+    if (node == nullptr) {
+        return nullptr;
+    }
+
+    // mark it removed, compaction unlinks and frees it later
+    node->key = TOMBSTONE;
+    tombstones++;
+    return node;
+}
+/**
+ * Insert a bid
+ *
+ * @param bid The bid to insert
+ */
+void HashTable::Insert(Bid bid) {
+    // FIXME (5): Implement logic to insert a bid
+    // carry on with any resize or compaction in progress
+    migrate(MIGRATE_BUCKETS);
+    compact(COMPACT_BUCKETS);
+
+    // create the key for the given bid
+    unsigned key = hash(bid.bidId);
+
+    // try and retrieve node using key
+    Node* oldNode = &(nodes.at(key));
+ 
+    // if no entry found for the key
+    if (oldNode == nullptr) {
+        // assign this node to the key position
+        Node* newNode = new Node(bid, key);
+        nodes.insert(nodes.begin() + key, *newNode);
+    }
+    // else if node is not used
+    else {
+        // assing old node key to UNIT_MAX, set to key, set old node to bid and old node next to null pointer
+        if (oldNode->key == UINT_MAX) {
+            oldNode->key = key;
+            oldNode->bid = bid;
+            oldNode->next = nullptr;
+        }
+        // else find the next open node, reusing a removed one on the way
+        else {
+            while (oldNode->key != TOMBSTONE && oldNode->next != nullptr) {
+                oldNode = oldNode->next;
+            }
+            if (oldNode->key == TOMBSTONE) {
+                oldNode->key = key;
+                oldNode->bid = bid;
+                tombstones--;
+            }
+            // add new newNode to end
+            else {
+                oldNode->next = new Node(bid, key);
+            }
+        }
+    }
+    size++;
+    COUNT_STAT(inserts);
+    if (funds != nullptr) {
+        funds->Insert(bid);
+    }
+
+    // grow once the chains are getting too long on average
+    if (maxLoadFactor > 0.0 && LoadFactor() > maxLoadFactor) {
+        rehash(nextPrime(tableSize * 2 + 1));
+    }
+}
+
+/**
+ * Print all bids
+ */
+void HashTable::PrintAll() {
+    // FIXME (6): Implement logic to print all bids
+    // for node begin to end iterate, including any old buckets not moved yet
+    for (vector<Node>* table : { &nodes, &oldNodes }) {
+        for (auto i = table->begin(); i != table->end(); i++) {
+            // if key not equal to UINT_MAx
+            if (i->key != UINT_MAX) {
+                // node is equal to the bucket head
+                Node* tempNode = &(*i);
+                // while node not equal to nullptr
+                while (tempNode != nullptr) {
+                    // output key, bidID, title, amount and fund, skipping removed bids
+                    if (tempNode->key != TOMBSTONE) {
+                        cout << "Key " << tempNode->key << ": " << tempNode->bid.bidId << " | " << tempNode->bid.title << " | " << tempNode->bid.fund << endl;
+                    }
+                    // node is equal to next node
+                    tempNode = tempNode->next;
+                }
+             }
+        }
+    }
+
+}
+
+/**
+ * Remove a bid
+ *
+ * @param bidId The bid id to search for
+ */
+void HashTable::Remove(string bidId) {
+    // FIXME (7): Implement logic to remove a bid
+    // carry on with any resize or compaction in progress
+    migrate(MIGRATE_BUCKETS);
+    compact(COMPACT_BUCKETS);
+
+    // hash the id once, it is reduced for both the new and old table
+    uint64_t hashValue = hashFunction(bidId);
+    Node* removed = removeNode(nodes, bucketFor(hashValue, tableSize), bidId);
+
+    // the bid may still be waiting in an old bucket that has not moved yet
+    if (removed == nullptr && oldTableSize > 0) {
+        unsigned oldKey = bucketFor(hashValue, oldTableSize);
+        if (oldKey >= migrateIndex) {
+            removed = removeNode(oldNodes, oldKey, bidId);
+        }
+    }
+    if (removed == nullptr) {
+        return;
+    }
+    size--;
+    COUNT_STAT(removes);
+    if (funds != nullptr) {
+        funds->Remove(removed->bid);
+    }
+
+    // shrink back down after a mass remove, never below the default size
+    if (minLoadFactor > 0.0 && tableSize > DEFAULT_SIZE && LoadFactor() < minLoadFactor) {
+        unsigned int newSize = nextPrime(tableSize / 2);
+        if (newSize < DEFAULT_SIZE) {
+            newSize = DEFAULT_SIZE;
+        }
+        rehash(newSize);
+    }
+}
+
+/**
+ * Find the bid with the specified bidId without copying it
+ *
+ * @param bidId The bid id to search for
+ * @return The bid in the table, nullptr if not found. It stays valid
+ *         until the table is next used, a later call may move it
+ *         while resizing.
+ */
+const Bid* HashTable::Find(string_view bidId) {
+    // FIXME (8): Implement logic to search for and return a bid
+    // carry on with any resize in progress
+    migrate(MIGRATE_BUCKETS);
+
+    // create the key for the given bid
+    uint64_t hashValue = hashFunction(bidId);
+
+    // try and retrieve node using key
+    Node* node = findNode(nodes, bucketFor(hashValue, tableSize), bidId);
+
+    // the bid may still be waiting in an old bucket that has not moved yet
+    if (node == nullptr && oldTableSize > 0) {
+        unsigned oldKey = bucketFor(hashValue, oldTableSize);
+        if (oldKey >= migrateIndex) {
+            node = findNode(oldNodes, oldKey, bidId);
+        }
+    }
+
+    // if entry found for the key
+    if (node != nullptr) {
+        COUNT_STAT(hits);
+        //return node bid
+        return &node->bid;
+    }
+    COUNT_STAT(misses);
+    return nullptr;
+}
+
+/**
+ * Search for the specified bidId
+ *
+ * @param bidId The bid id to search for
+ * @return A copy of the bid, empty if not found
+ */
+Bid HashTable::Search(string bidId) {
+    const Bid* found = Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+    Bid bid;
+    return bid;
+}
+
+/**
+ * Find many bids at once without copying them. Keys are hashed and
+ * their buckets prefetched a group at a time, so the cache misses of a
+ * whole group overlap instead of being paid one after another.
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until the table is next used.
+ */
+void HashTable::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    // carry on with any resize in progress once, as Find does, then
+    // leave both tables alone so the bids found do not move
+    migrate(MIGRATE_BUCKETS);
+    results.assign(bidIds.size(), nullptr);
+
+    unsigned int keys[BATCH_GROUP];
+    unsigned int oldKeys[BATCH_GROUP];
+    for (size_t start = 0; start < bidIds.size(); start += BATCH_GROUP) {
+        size_t end = min(bidIds.size(), start + BATCH_GROUP);
+
+        // hash the whole group and start loading every bucket, during an
+        // incremental resize the old bucket too if it has not moved yet
+        for (size_t i = start; i < end; i++) {
+            uint64_t hashValue = hashFunction(bidIds[i]);
+            keys[i - start] = bucketFor(hashValue, tableSize);
+            PREFETCH(&nodes[keys[i - start]]);
+            oldKeys[i - start] = UINT_MAX;
+            if (oldTableSize > 0) {
+                unsigned int oldKey = bucketFor(hashValue, oldTableSize);
+                if (oldKey >= migrateIndex) {
+                    oldKeys[i - start] = oldKey;
+                    PREFETCH(&oldNodes[oldKey]);
+                }
+            }
+        }
+
+        // start loading the second node of every chain that has one
+        for (size_t i = start; i < end; i++) {
+            Node* next = nodes[keys[i - start]].next;
+            if (next != nullptr) {
+                PREFETCH(next);
+            }
+        }
+
+        // by now the buckets should be in cache
+        for (size_t i = start; i < end; i++) {
+            Node* node = findNode(nodes, keys[i - start], bidIds[i]);
+            if (node == nullptr && oldKeys[i - start] != UINT_MAX) {
+                node = findNode(oldNodes, oldKeys[i - start], bidIds[i]);
+            }
+            if (node != nullptr) {
+                COUNT_STAT(hits);
+                results[i] = &node->bid;
+            }
+            else {
+                COUNT_STAT(misses);
+            }
+        }
+    }
+}
+
+/**
+ * Returns a copy of every bid in the table, in bucket order
+ */
+vector<Bid> HashTable::GetAllBids() {
+    vector<Bid> bids;
+    for (vector<Node>* table : { &nodes, &oldNodes }) {
+        for (auto i = table->begin(); i != table->end(); i++) {
+            if (i->key == UINT_MAX) {
+                continue;
+            }
+            for (Node* node = &(*i); node != nullptr; node = node->next) {
+                if (node->key != TOMBSTONE) {
+                    bids.push_back(node->bid);
+                }
+            }
+        }
+    }
+    return bids;
+}
+
+/**
+ * Returns the index of the table's bids by fund. The first call builds
+ * it from the bids already stored, from then on every Insert and Remove
+ * keeps it up to date, so make that call before other threads start
+ * changing the table.
+ */
+FundIndex& HashTable::Funds() {
+    if (funds == nullptr) {
+        funds = new FundIndex();
+        for (Bid& bid : GetAllBids()) {
+            funds->Insert(bid);
+        }
+    }
+    return *funds;
+}
+
+/**
+ * Heap memory held by a bid's strings beyond the Bid itself
+ */
+size_t HashTable::bidBytes(const Bid& bid) {
+    size_t bytes = 0;
+    for (const string* text : { &bid.bidId, &bid.title, &bid.fund }) {
+        // short strings live inside the string object itself
+        if (text->capacity() > string().capacity()) {
+            bytes += text->capacity() + 1;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * Report bucket occupancy, the chain length histogram, memory use and
+ * the operation counters. Engines without buckets only report their
+ * size and counters.
+ *
+ * @return Snapshot of the table
+ */
+TableStats HashTable::GetStats() {
+    TableStats stats = counters;
+    stats.bids = Size();
+    stats.buckets = Capacity();
+    stats.loadFactor = LoadFactor();
+    stats.tombstones = tombstones;
+    stats.bytesUsed = sizeof(*this);
+
+    for (vector<Node>* table : { &nodes, &oldNodes }) {
+        stats.bytesUsed += table->capacity() * sizeof(Node);
+        for (auto i = table->begin(); i != table->end(); i++) {
+            // chain length counts tombstones too, they are still walked
+            unsigned int chain = 0;
+            if (i->key != UINT_MAX) {
+                for (Node* node = &(*i); node != nullptr; node = node->next) {
+                    chain++;
+                    stats.bytesUsed += bidBytes(node->bid);
+                    if (node != &(*i)) {
+                        stats.bytesUsed += sizeof(Node);
+                    }
+                }
+                stats.usedBuckets++;
+            }
+            if (chain >= stats.chainHistogram.size()) {
+                stats.chainHistogram.resize(chain + 1, 0);
+            }
+            stats.chainHistogram[chain]++;
+            stats.maxChain = max(stats.maxChain, chain);
+        }
+    }
+    return stats;
+}
+
+/**
+ * Zero the hit, miss, compare, insert and remove counters
+ */
+void HashTable::ResetCounters() {
+    counters = TableStats();
+}
+
+/**
+ * Set the load factor that triggers growing the table
+ *
+ * @param loadFactor Average chain length to grow at, 0 disables growing
+ */
+void HashTable::SetMaxLoadFactor(double loadFactor) {
+    maxLoadFactor = loadFactor;
+}
+
+/**
+ * Set the load factor that triggers shrinking the table after a remove
+ *
+ * @param loadFactor Average chain length to shrink at, 0 disables shrinking
+ */
+void HashTable::SetMinLoadFactor(double loadFactor) {
+    minLoadFactor = loadFactor;
+}
+
+/**
+ * Returns the average number of bids per bucket
+ */
+double HashTable::LoadFactor() {
+    return (double) size / tableSize;
+}
+
+/**
+ * Returns the number of bids in the table
+ */
+unsigned int HashTable::Size() {
+    return size;
+}
+
+/**
+ * Returns the number of buckets in the table
+ */
+unsigned int HashTable::Capacity() {
+    return tableSize;
+}
+
+/**
+ * Choose how the table resizes. Incremental resizing keeps the old
+ * table around and moves MIGRATE_BUCKETS buckets on every operation
+ * instead of stopping to move them all at once.
+ *
+ * @param incremental true to resize a few buckets at a time
+ */
+void HashTable::SetIncrementalRehash(bool incremental) {
+    incrementalRehash = incremental;
+
+    // switching it off finishes any resize in progress
+    if (!incremental) {
+        migrate(oldTableSize);
+    }
+}
+
+/**
+ * Turn the operation counters on or off, for tables whose searches
+ * run on several threads at once
+ *
+ * @param collect Whether Search, Insert and Remove are counted
+ */
+void HashTable::SetCollectStats(bool collect) {
+    collectStats = collect;
+}
+
+/**
+ * Replace the hash function, every bid is rehashed right away
+ *
+ * @param function The hash policy to use from now on
+ */
+void HashTable::SetHashFunction(HashFunction function) {
+    // old buckets were placed with the previous function, move them first
+    migrate(oldTableSize);
+    hashFunction = function;
+
+    // rebuild in one go, an incremental move would look in the wrong buckets
+    bool incremental = incrementalRehash;
+    incrementalRehash = false;
+    rehash(tableSize);
+    incrementalRehash = incremental;
+}
+
+/**
+ * Returns the number of removed bids not yet compacted away
+ */
+unsigned int HashTable::Tombstones() {
+    return tombstones;
+}
+
+/**
+ * Returns true while an incremental resize is still moving buckets
+ */
+bool HashTable::IsRehashing() {
+    return oldTableSize > 0;
+}
+
+
+//============================================================================
+// Flat Hash Table class definition
+//============================================================================
+
+/**
+ * Define a class implementing the hash table with open addressing
+ * (SwissTable style). Each slot has a one byte control value holding
+ * 7 bits of the hash, and a group of 16 control bytes is compared
+ * with a single SSE2 instruction, so most misses never read a bid.
+ */
+class FlatHashTable : public HashTable {
+
+private:
+    // control byte values, a full slot holds the low 7 hash bits (0-127)
+    static constexpr int8_t EMPTY = -128;
+    static constexpr int8_t DELETED = -2;
+
+    vector<int8_t> control;
+    vector<Bid> slots;
+
+    unsigned int groupMask = 0; // number of groups - 1
+    unsigned int size = 0;
+    unsigned int deleted = 0;
+
+    static unsigned int matchByte(const int8_t* group, int8_t value);
+    int findSlot(string_view bidId, uint64_t hashValue);
+    unsigned int findFree(uint64_t hashValue);
+    void resize(unsigned int groups);
+
+public:
+    FlatHashTable();
+    FlatHashTable(unsigned int size);
+    void Insert(Bid bid);
+    void PrintAll();
+    void Remove(string bidId);
+    const Bid* Find(string_view bidId);
+    Bid Search(string bidId);
+    void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    vector<Bid> GetAllBids();
+    double LoadFactor();
+    unsigned int Size();
+    unsigned int Capacity();
+    void SetHashFunction(HashFunction function);
+    TableStats GetStats();
+};
+
+/**
+ * Default constructor
+ */
+FlatHashTable::FlatHashTable() : FlatHashTable(DEFAULT_SIZE) {
+}
+
+/**
+ * Constructor for specifying the expected number of bids,
+ * rounded up to a power of two number of groups
+ */
+FlatHashTable::FlatHashTable(unsigned int size) : HashTable(wyHash) {
+    unsigned int groups = 1;
+    while (groups * GROUP_WIDTH * 7 / 8 < size) {
+        groups *= 2;
+    }
+    resize(groups);
+}
+
+/**
+ * Compare one group of control bytes against a value
+ *
+ * @param group The first control byte of the group
+ * @param value The control byte to look for
+ * @return Bit i is set if slot i of the group matches
+ */
+unsigned int FlatHashTable::matchByte(const int8_t* group, int8_t value) {
+#ifdef HASHTABLE_SSE2
+    __m128i controls = _mm_loadu_si128((const __m128i*) group);
+    return (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(controls, _mm_set1_epi8(value)));
+#else
+    unsigned int mask = 0;
+    for (unsigned int i = 0; i < GROUP_WIDTH; i++) {
+        if (group[i] == value) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+/**
+ * Index of the lowest set bit of a non-zero group match
+ */
+static unsigned int lowestBit(unsigned int mask) {
+    unsigned int i = 0;
+    while ((mask & 1u) == 0) {
+        mask >>= 1;
+        i++;
+    }
+    return i;
+}
+
+/**
+ * Find the slot holding bidId
+ *
+ * @param bidId The bid id to search for
+ * @param hashValue The full hash of bidId
+ * @return The slot index or -1 if not found
+ */
+int FlatHashTable::findSlot(string_view bidId, uint64_t hashValue) {
+    int8_t fingerprint = (int8_t) (hashValue & 0x7f);
+    unsigned int group = (unsigned int) (hashValue >> 7) & groupMask;
+
+    // triangular probing visits every group once when the count is a power of two
+    for (unsigned int step = 1; step <= groupMask + 1; step++) {
+        const int8_t* groupControl = &control[group * GROUP_WIDTH];
+
+        // only slots with a matching fingerprint need the key compared
+        unsigned int matches = matchByte(groupControl, fingerprint);
+        while (matches != 0) {
+            unsigned int i = group * GROUP_WIDTH + lowestBit(matches);
+            COUNT_STAT(keyCompares);
+            if (slots[i].bidId == bidId) {
+                return (int) i;
+            }
+            matches &= matches - 1;
+        }
+
+        // an empty slot means the bid was never pushed further along
+        if (matchByte(groupControl, EMPTY) != 0) {
+            return -1;
+        }
+        group = (group + step) & groupMask;
+    }
+    return -1;
+}
+
+/**
+ * Find the first empty or deleted slot along the probe sequence of a hash
+ *
+ * @param hashValue The full hash of the bid id being inserted
+ * @return The slot index
+ */
+unsigned int FlatHashTable::findFree(uint64_t hashValue) {
+    unsigned int group = (unsigned int) (hashValue >> 7) & groupMask;
+    for (unsigned int step = 1; ; step++) {
+        const int8_t* groupControl = &control[group * GROUP_WIDTH];
+        unsigned int free = matchByte(groupControl, EMPTY) | matchByte(groupControl, DELETED);
+        if (free != 0) {
+            return group * GROUP_WIDTH + lowestBit(free);
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+/**
+ * Move every bid into a table with the given number of groups,
+ * which also drops all deleted markers
+ *
+ * @param groups The new number of groups, a power of two
+ */
+void FlatHashTable::resize(unsigned int groups) {
+    vector<int8_t> oldControl(groups * GROUP_WIDTH, EMPTY);
+    vector<Bid> oldSlots(groups * GROUP_WIDTH);
+    oldControl.swap(control);
+    oldSlots.swap(slots);
+    groupMask = groups - 1;
+    deleted = 0;
+
+    for (unsigned int i = 0; i < oldControl.size(); i++) {
+        if (oldControl[i] >= 0) {
+            uint64_t hashValue = hashFunction(oldSlots[i].bidId);
+            unsigned int slot = findFree(hashValue);
+            control[slot] = (int8_t) (hashValue & 0x7f);
+            slots[slot] = move(oldSlots[i]);
+        }
+    }
+}
+
+/**
+ * Insert a bid
+ *
+ * @param bid The bid to insert
+ */
+void FlatHashTable::Insert(Bid bid) {
+    // keep at least 1/8 of the slots empty so probes stay short
+    if ((size + deleted + 1) * 8 > Capacity() * 7) {
+        // mostly deleted markers, rebuilding at the same size is enough
+        unsigned int groups = groupMask + 1;
+        resize(size * 2 < Capacity() * 7 / 8 ? groups : groups * 2);
+    }
+
+    uint64_t hashValue = hashFunction(bid.bidId);
+    unsigned int slot = findFree(hashValue);
+    if (control[slot] == DELETED) {
+        deleted--;
+    }
+    control[slot] = (int8_t) (hashValue & 0x7f);
+    slots[slot] = bid;
+    size++;
+    COUNT_STAT(inserts);
+    if (funds != nullptr) {
+        funds->Insert(slots[slot]);
+    }
+}
+
+/**
+ * Print all bids
+ */
+void FlatHashTable::PrintAll() {
+    for (unsigned int i = 0; i < control.size(); i++) {
+        if (control[i] >= 0) {
+            cout << "Key " << i << ": " << slots[i].bidId << " | " << slots[i].title << " | " << slots[i].fund << endl;
+        }
+    }
+}
+
+/**
+ * Remove a bid
+ *
+ * @param bidId The bid id to search for
+ */
+void FlatHashTable::Remove(string bidId) {
+    int slot = findSlot(bidId, hashFunction(bidId));
+    if (slot < 0) {
+        return;
+    }
+
+    if (funds != nullptr) {
+        funds->Remove(slots[slot]);
+    }
+
+    // mark the slot deleted rather than empty so later probes keep going
+    control[slot] = DELETED;
+    slots[slot] = Bid();
+    size--;
+    deleted++;
+    COUNT_STAT(removes);
+}
+
+/**
+ * Find the bid with the specified bidId without copying it
+ *
+ * @param bidId The bid id to search for
+ * @return The bid in its slot, nullptr if not found. It stays valid
+ *         until the next insert or remove.
+ */
+const Bid* FlatHashTable::Find(string_view bidId) {
+    int slot = findSlot(bidId, hashFunction(bidId));
+    if (slot < 0) {
+        COUNT_STAT(misses);
+        return nullptr;
+    }
+    COUNT_STAT(hits);
+    return &slots[slot];
+}
+
+/**
+ * Search for the specified bidId
+ *
+ * @param bidId The bid id to search for
+ */
+Bid FlatHashTable::Search(string bidId) {
+    const Bid* found = Find(bidId);
+    if (found == nullptr) {
+        Bid bid;
+        return bid;
+    }
+    return *found;
+}
+
+/**
+ * Find many bids at once without copying them, prefetching the control
+ * bytes and first slots of each key's group before any of them is probed
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until the next insert or remove.
+ */
+void FlatHashTable::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    results.assign(bidIds.size(), nullptr);
+
+    uint64_t hashes[BATCH_GROUP];
+    for (size_t start = 0; start < bidIds.size(); start += BATCH_GROUP) {
+        size_t end = min(bidIds.size(), start + BATCH_GROUP);
+
+        for (size_t i = start; i < end; i++) {
+            hashes[i - start] = hashFunction(bidIds[i]);
+            unsigned int group = (unsigned int) (hashes[i - start] >> 7) & groupMask;
+            PREFETCH(&control[group * GROUP_WIDTH]);
+            PREFETCH(&slots[group * GROUP_WIDTH]);
+        }
+
+        for (size_t i = start; i < end; i++) {
+            int slot = findSlot(bidIds[i], hashes[i - start]);
+            if (slot >= 0) {
+                results[i] = &slots[slot];
+            }
+        }
+    }
+}
+
+/**
+ * Returns a copy of every bid in the table, in slot order
+ */
+vector<Bid> FlatHashTable::GetAllBids() {
+    vector<Bid> bids;
+    for (unsigned int i = 0; i < control.size(); i++) {
+        if (control[i] >= 0) {
+            bids.push_back(slots[i]);
+        }
+    }
+    return bids;
+}
+
+/**
+ * Report slot occupancy and a histogram of how many groups each bid
+ * sits from its home group (1 = found in the first group probed)
+ *
+ * @return Snapshot of the table
+ */
+TableStats FlatHashTable::GetStats() {
+    TableStats stats = counters;
+    stats.bids = size;
+    stats.buckets = Capacity();
+    stats.loadFactor = LoadFactor();
+    stats.tombstones = deleted;
+    stats.bytesUsed = sizeof(*this) + control.capacity() + slots.capacity() * sizeof(Bid);
+
+    for (unsigned int i = 0; i < control.size(); i++) {
+        if (control[i] < 0) {
+            continue;
+        }
+        stats.usedBuckets++;
+        stats.bytesUsed += bidBytes(slots[i]);
+
+        // replay the probe sequence until it reaches this slot's group
+        uint64_t hashValue = hashFunction(slots[i].bidId);
+        unsigned int group = (unsigned int) (hashValue >> 7) & groupMask;
+        unsigned int probes = 1;
+        for (unsigned int step = 1; group != i / GROUP_WIDTH; step++) {
+            group = (group + step) & groupMask;
+            probes++;
+        }
+        if (probes >= stats.chainHistogram.size()) {
+            stats.chainHistogram.resize(probes + 1, 0);
+        }
+        stats.chainHistogram[probes]++;
+        stats.maxChain = max(stats.maxChain, probes);
+    }
+    return stats;
+}
+
+/**
+ * Returns the fraction of slots holding a bid
+ */
+double FlatHashTable::LoadFactor() {
+    return (double) size / Capacity();
+}
+
+/**
+ * Returns the number of bids in the table
+ */
+unsigned int FlatHashTable::Size() {
+    return size;
+}
+
+/**
+ * Returns the number of slots in the table
+ */
+unsigned int FlatHashTable::Capacity() {
+    return (unsigned int) control.size();
+}
+
+/**
+ * Replace the hash function, every bid is rehashed right away
+ *
+ * @param function The hash policy to use from now on
+ */
+void FlatHashTable::SetHashFunction(HashFunction function) {
+    hashFunction = function;
+    resize(groupMask + 1);
+}
+
+//============================================================================
+// Concurrent Hash Table class definition
+//============================================================================
+
+/**
+ * Define a class implementing a thread safe hash table split into
+ * shards. Each shard is a chaining HashTable behind its own reader/writer
+ * lock, so searches never block each other and writers only block the
+ * shard they touch.
+ */
+class ConcurrentHashTable : public HashTable {
+
+private:
+    // aligned so two shards' locks never share a cache line
+    struct alignas(64) Shard {
+        HashTable table;
+        shared_mutex lock;
+    };
+
+    Shard* shards;
+    unsigned int shardCount;
+
+    Shard& shardFor(string_view bidId);
+
+public:
+    ConcurrentHashTable();
+    ConcurrentHashTable(unsigned int shards);
+    virtual ~ConcurrentHashTable();
+    void Insert(Bid bid);
+    void PrintAll();
+    void Remove(string bidId);
+    const Bid* Find(string_view bidId);
+    Bid Search(string bidId);
+    void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    vector<Bid> GetAllBids();
+    double LoadFactor();
+    unsigned int Size();
+    unsigned int Capacity();
+    void SetHashFunction(HashFunction function);
+    TableStats GetStats();
+};
+
+/**
+ * Default constructor
+ */
+ConcurrentHashTable::ConcurrentHashTable() : ConcurrentHashTable(DEFAULT_SHARDS) {
+}
+
+/**
+ * Constructor for specifying the number of shards,
+ * rounded up to a power of two
+ */
+ConcurrentHashTable::ConcurrentHashTable(unsigned int shards) : HashTable(wyHash) {
+    shardCount = 1;
+    while (shardCount < shards) {
+        shardCount *= 2;
+    }
+    this->shards = new Shard[shardCount];
+
+    // shard searches run in parallel under a shared lock, so the plain
+    // counters inside them would race
+    for (unsigned int i = 0; i < shardCount; i++) {
+        this->shards[i].table.SetCollectStats(false);
+    }
+}
+
+/**
+ * Destructor
+ */
+ConcurrentHashTable::~ConcurrentHashTable() {
+    delete[] shards;
+}
+
+/**
+ * Pick the shard for a bid id. The shard comes from the low bits of the
+ * hash, the shard's own buckets from the high bits, so the two are
+ * independent.
+ *
+ * @param bidId The bid id to place
+ * @return The shard holding the bid
+ */
+ConcurrentHashTable::Shard& ConcurrentHashTable::shardFor(string_view bidId) {
+    return shards[hashFunction(bidId) & (shardCount - 1)];
+}
+
+/**
+ * Insert a bid
+ *
+ * @param bid The bid to insert
+ */
+void ConcurrentHashTable::Insert(Bid bid) {
+    Shard& shard = shardFor(bid.bidId);
+    unique_lock<shared_mutex> guard(shard.lock);
+    shard.table.Insert(bid);
+    // under the shard lock, so the index sees one id's changes in order
+    if (funds != nullptr) {
+        funds->Insert(bid);
+    }
+}
+
+/**
+ * Print all bids, one shard at a time
+ */
+void ConcurrentHashTable::PrintAll() {
+    for (unsigned int i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        shards[i].table.PrintAll();
+    }
+}
+
+/**
+ * Remove a bid
+ *
+ * @param bidId The bid id to search for
+ */
+void ConcurrentHashTable::Remove(string bidId) {
+    Shard& shard = shardFor(bidId);
+    unique_lock<shared_mutex> guard(shard.lock);
+    if (funds != nullptr) {
+        const Bid* removed = shard.table.Find(bidId);
+        if (removed != nullptr) {
+            funds->Remove(*removed);
+        }
+    }
+    shard.table.Remove(bidId);
+}
+
+/**
+ * Find the bid with the specified bidId. Another thread may change the
+ * shard as soon as its lock is released, so the bid is copied into a
+ * buffer kept by the calling thread; its strings keep their capacity,
+ * so repeated finds stop allocating once the buffer has grown.
+ *
+ * @param bidId The bid id to search for
+ * @return The copy, valid until this thread's next Find, nullptr if not found
+ */
+const Bid* ConcurrentHashTable::Find(string_view bidId) {
+    static thread_local Bid found;
+    Shard& shard = shardFor(bidId);
+    shared_lock<shared_mutex> guard(shard.lock);
+    const Bid* bid = shard.table.Find(bidId);
+    if (bid == nullptr) {
+        return nullptr;
+    }
+    found = *bid;
+    return &found;
+}
+
+/**
+ * Search for the specified bidId. Shards never resize incrementally,
+ * so a search under the shared lock does not modify the shard.
+ *
+ * @param bidId The bid id to search for
+ */
+Bid ConcurrentHashTable::Search(string bidId) {
+    Shard& shard = shardFor(bidId);
+    shared_lock<shared_mutex> guard(shard.lock);
+    return shard.table.Search(bidId);
+}
+
+/**
+ * Find many bids, one shared lock at a time. Another thread may change
+ * a shard once its lock is let go, so as with Find the bids are copied
+ * into buffers kept by the calling thread whose strings keep their
+ * capacity between batches.
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until this thread's next SearchBatch.
+ */
+void ConcurrentHashTable::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    static thread_local vector<Bid> found;
+    if (found.size() < bidIds.size()) {
+        found.resize(bidIds.size());
+    }
+    results.assign(bidIds.size(), nullptr);
+    for (size_t i = 0; i < bidIds.size(); i++) {
+        Shard& shard = shardFor(bidIds[i]);
+        shared_lock<shared_mutex> guard(shard.lock);
+        const Bid* bid = shard.table.Find(bidIds[i]);
+        if (bid != nullptr) {
+            found[i] = *bid;
+            results[i] = &found[i];
+        }
+    }
+}
+
+/**
+ * Returns a copy of every bid in the table, one shard at a time
+ */
+vector<Bid> ConcurrentHashTable::GetAllBids() {
+    vector<Bid> bids;
+    for (unsigned int i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        vector<Bid> shardBids = shards[i].table.GetAllBids();
+        bids.insert(bids.end(), shardBids.begin(), shardBids.end());
+    }
+    return bids;
+}
+
+/**
+ * Combine the layout statistics of every shard, operation counters
+ * are not kept by the shards
+ *
+ * @return Snapshot of the table
+ */
+TableStats ConcurrentHashTable::GetStats() {
+    TableStats stats;
+    stats.bytesUsed = sizeof(*this) + shardCount * sizeof(Shard);
+    for (unsigned int i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        TableStats shardStats = shards[i].table.GetStats();
+        stats.bids += shardStats.bids;
+        stats.buckets += shardStats.buckets;
+        stats.usedBuckets += shardStats.usedBuckets;
+        stats.tombstones += shardStats.tombstones;
+        stats.maxChain = max(stats.maxChain, shardStats.maxChain);
+        stats.bytesUsed += shardStats.bytesUsed - sizeof(HashTable);
+        if (shardStats.chainHistogram.size() > stats.chainHistogram.size()) {
+            stats.chainHistogram.resize(shardStats.chainHistogram.size(), 0);
+        }
+        for (unsigned int length = 0; length < shardStats.chainHistogram.size(); length++) {
+            stats.chainHistogram[length] += shardStats.chainHistogram[length];
+        }
+    }
+    stats.loadFactor = stats.buckets == 0 ? 0.0 : (double) stats.bids / stats.buckets;
+    return stats;
+}
+
+/**
+ * Returns the average number of bids per bucket over all shards
+ */
+double ConcurrentHashTable::LoadFactor() {
+    return (double) Size() / Capacity();
+}
+
+/**
+ * Returns the number of bids in the table
+ */
+unsigned int ConcurrentHashTable::Size() {
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        total += shards[i].table.Size();
+    }
+    return total;
+}
+
+/**
+ * Returns the number of buckets over all shards
+ */
+unsigned int ConcurrentHashTable::Capacity() {
+    unsigned int total = 0;
+    for (unsigned int i = 0; i < shardCount; i++) {
+        shared_lock<shared_mutex> guard(shards[i].lock);
+        total += shards[i].table.Capacity();
+    }
+    return total;
+}
+
+/**
+ * Replace the hash function. Bids would move between shards, so this
+ * is refused once any bid has been inserted.
+ *
+ * @param function The hash policy to use from now on
+ */
+void ConcurrentHashTable::SetHashFunction(HashFunction function) {
+    vector<unique_lock<shared_mutex>> guards;
+    for (unsigned int i = 0; i < shardCount; i++) {
+        guards.emplace_back(shards[i].lock);
+    }
+    for (unsigned int i = 0; i < shardCount; i++) {
+        if (shards[i].table.Size() > 0) {
+            cout << "The hash function can only change while the table is empty." << endl;
+            return;
+        }
+    }
+    hashFunction = function;
+    for (unsigned int i = 0; i < shardCount; i++) {
+        shards[i].table.SetHashFunction(function);
+    }
+}
+
+//============================================================================
+// Epoch based reclamation
+//============================================================================
+
+/**
+ * Define a class that tells writers when memory unlinked from a lock-free
+ * structure can be freed. Readers publish the global epoch they entered
+ * in, and anything retired in an epoch older than every active reader
+ * can no longer be reached.
+ */
+class EpochManager {
+
+private:
+    // one slot per reader thread, 0 means the thread is not reading
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{ 0 };
+        atomic<bool> used{ false };
+    };
+
+    atomic<uint64_t> globalEpoch{ 1 };
+    ReaderSlot readers[MAX_READERS];
+
+public:
+    ReaderSlot& slotForThread();
+    void Enter();
+    void Exit();
+    uint64_t Advance();
+    uint64_t OldestActive();
+    void Release(ReaderSlot* slot);
+};
+
+/**
+ * Claim a reader slot the first time a thread reads and hand it back
+ * when the thread exits. Throws runtime_error when all MAX_READERS slots
+ * are held by live threads
+ */
+EpochManager::ReaderSlot& EpochManager::slotForThread() {
+    struct SlotOwner {
+        EpochManager* manager = nullptr;
+        ReaderSlot* slot = nullptr;
+        ~SlotOwner() {
+            if (slot != nullptr) {
+                manager->Release(slot);
+            }
+        }
+    };
+    thread_local SlotOwner owner;
+
+    if (owner.slot == nullptr) {
+        for (unsigned int i = 0; i < MAX_READERS && owner.slot == nullptr; i++) {
+            bool expected = false;
+            if (readers[i].used.compare_exchange_strong(expected, true)) {
+                owner.manager = this;
+                owner.slot = &readers[i];
+            }
+        }
+        // waiting for a slot could spin forever if no reader thread exits
+        if (owner.slot == nullptr) {
+            throw runtime_error("more than " + to_string(MAX_READERS) + " threads reading a lock-free table");
+        }
+    }
+    return *owner.slot;
+}
+
+/**
+ * Mark the calling thread as reading in the current epoch
+ */
+void EpochManager::Enter() {
+    // sequentially consistent so writers scanning the slots either see
+    // this reader or the reader sees everything they unlinked
+    slotForThread().epoch.store(globalEpoch.load());
+}
+
+/**
+ * Mark the calling thread as no longer reading
+ */
+void EpochManager::Exit() {
+    slotForThread().epoch.store(0, memory_order_release);
+}
+
+/**
+ * Start a new epoch
+ *
+ * @return The epoch that just ended, to stamp retired memory with
+ */
+uint64_t EpochManager::Advance() {
+    return globalEpoch.fetch_add(1);
+}
+
+/**
+ * Returns the oldest epoch an active reader entered in,
+ * or UINT64_MAX if nobody is reading
+ */
+uint64_t EpochManager::OldestActive() {
+    uint64_t oldest = UINT64_MAX;
+    for (unsigned int i = 0; i < MAX_READERS; i++) {
+        uint64_t epoch = readers[i].epoch.load();
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * Give a reader slot back once its thread exits
+ */
+void EpochManager::Release(ReaderSlot* slot) {
+    slot->epoch.store(0);
+    slot->used.store(false);
+}
+
+//============================================================================
+// Lock-Free Read Hash Table class definition
+//============================================================================
+
+/**
+ * Define a class implementing a hash table tuned for read-heavy
+ * concurrent use. Searches take no lock at all, they walk chains of
+ * atomic pointers. Writers serialize on one mutex, publish new nodes
+ * with a single atomic store and hand removed nodes to an EpochManager
+ * so they are only freed once no reader can still be looking at them.
+ */
+class LockFreeHashTable : public HashTable {
+
+private:
+    struct LfNode {
+        Bid bid;
+        uint64_t hashValue;
+        atomic<LfNode*> next;
+
+        LfNode(Bid aBid, uint64_t aHash) : bid(aBid), hashValue(aHash), next(nullptr) {
+        }
+    };
+
+    // bucket array, replaced as a whole when the table grows
+    struct LfTable {
+        unsigned int size;
+        atomic<LfNode*>* heads;
+
+        LfTable(unsigned int aSize) : size(aSize) {
+            heads = new atomic<LfNode*>[aSize];
+            for (unsigned int i = 0; i < aSize; i++) {
+                heads[i].store(nullptr, memory_order_relaxed);
+            }
+        }
+    };
+
+    // memory unlinked in an epoch, either one node or a whole old table
+    struct Retired {
+        uint64_t epoch;
+        LfNode* node;
+        LfTable* table;
+    };
+
+    atomic<LfTable*> table;
+    atomic<unsigned int> size{ 0 };
+    mutex writeLock;
+    vector<Retired> retired;
+
+    static EpochManager epochs;
+
+    void grow();
+    void reclaim(bool all);
+    static void freeTable(LfTable* oldTable);
+
+public:
+    LockFreeHashTable();
+    LockFreeHashTable(unsigned int size);
+    virtual ~LockFreeHashTable();
+    void Insert(Bid bid);
+    void PrintAll();
+    void Remove(string bidId);
+    const Bid* Find(string_view bidId);
+    Bid Search(string bidId);
+    void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    vector<Bid> GetAllBids();
+    double LoadFactor();
+    unsigned int Size();
+    unsigned int Capacity();
+    void SetHashFunction(HashFunction function);
+};
+
+EpochManager LockFreeHashTable::epochs;
+
+/**
+ * Default constructor
+ */
+LockFreeHashTable::LockFreeHashTable() : LockFreeHashTable(DEFAULT_SIZE) {
+}
+
+/**
+ * Constructor for specifying size of the table
+ */
+LockFreeHashTable::LockFreeHashTable(unsigned int size) : HashTable(wyHash) {
+    table.store(new LfTable(size));
+}
+
+/**
+ * Destructor, no reader may still be using the table
+ */
+LockFreeHashTable::~LockFreeHashTable() {
+    reclaim(true);
+    freeTable(table.load());
+}
+
+/**
+ * Free a bucket array along with every node still chained in it
+ */
+void LockFreeHashTable::freeTable(LfTable* oldTable) {
+    for (unsigned int i = 0; i < oldTable->size; i++) {
+        LfNode* node = oldTable->heads[i].load(memory_order_relaxed);
+        while (node != nullptr) {
+            LfNode* nextNode = node->next.load(memory_order_relaxed);
+            delete node;
+            node = nextNode;
+        }
+    }
+    delete[] oldTable->heads;
+    delete oldTable;
+}
+
+/**
+ * Free retired memory that no reader can reach anymore.
+ * Called with the write lock held.
+ *
+ * @param all Free everything regardless of readers (destructor only)
+ */
+void LockFreeHashTable::reclaim(bool all) {
+    uint64_t oldest = all ? UINT64_MAX : epochs.OldestActive();
+
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < retired.size(); i++) {
+        // readers that entered after the retiring epoch never saw it
+        if (retired[i].epoch < oldest) {
+            if (retired[i].table != nullptr) {
+                freeTable(retired[i].table);
+            }
+            else {
+                delete retired[i].node;
+            }
+        }
+        else {
+            retired[kept++] = retired[i];
+        }
+    }
+    retired.resize(kept);
+}
+
+/**
+ * Copy every bid into a bucket array twice the size and publish it.
+ * Readers already walking the old array keep going undisturbed, it is
+ * retired and freed once they are all done. Called with the write lock held.
+ */
+void LockFreeHashTable::grow() {
+    LfTable* oldTable = table.load(memory_order_relaxed);
+    LfTable* newTable = new LfTable(nextPrime(oldTable->size * 2 + 1));
+
+    for (unsigned int i = 0; i < oldTable->size; i++) {
+        LfNode* node = oldTable->heads[i].load(memory_order_relaxed);
+        while (node != nullptr) {
+            unsigned int key = bucketFor(node->hashValue, newTable->size);
+            LfNode* copy = new LfNode(node->bid, node->hashValue);
+            copy->next.store(newTable->heads[key].load(memory_order_relaxed), memory_order_relaxed);
+            newTable->heads[key].store(copy, memory_order_relaxed);
+            node = node->next.load(memory_order_relaxed);
+        }
+    }
+
+    table.store(newTable, memory_order_release);
+    retired.push_back({ epochs.Advance(), nullptr, oldTable });
+}
+
+/**
+ * Insert a bid
+ *
+ * @param bid The bid to insert
+ */
+void LockFreeHashTable::Insert(Bid bid) {
+    lock_guard<mutex> guard(writeLock);
+
+    LfTable* current = table.load(memory_order_relaxed);
+    if (size.load(memory_order_relaxed) + 1 > current->size) {
+        grow();
+        current = table.load(memory_order_relaxed);
+    }
+
+    // the node is complete before the release store makes it visible
+    uint64_t hashValue = hashFunction(bid.bidId);
+    unsigned int key = bucketFor(hashValue, current->size);
+    LfNode* node = new LfNode(bid, hashValue);
+    node->next.store(current->heads[key].load(memory_order_relaxed), memory_order_relaxed);
+    current->heads[key].store(node, memory_order_release);
+    size.fetch_add(1, memory_order_relaxed);
+    if (funds != nullptr) {
+        funds->Insert(node->bid);
+    }
+}
+
+/**
+ * Print all bids
+ */
+void LockFreeHashTable::PrintAll() {
+    epochs.Enter();
+    LfTable* current = table.load(memory_order_acquire);
+    for (unsigned int i = 0; i < current->size; i++) {
+        LfNode* node = current->heads[i].load(memory_order_acquire);
+        while (node != nullptr) {
+            cout << "Key " << i << ": " << node->bid.bidId << " | " << node->bid.title << " | " << node->bid.fund << endl;
+            node = node->next.load(memory_order_acquire);
+        }
+    }
+    epochs.Exit();
+}
+
+/**
+ * Remove a bid
+ *
+ * @param bidId The bid id to search for
+ */
+void LockFreeHashTable::Remove(string bidId) {
+    lock_guard<mutex> guard(writeLock);
+
+    uint64_t hashValue = hashFunction(bidId);
+    LfTable* current = table.load(memory_order_relaxed);
+    atomic<LfNode*>* link = &(current->heads[bucketFor(hashValue, current->size)]);
+
+    LfNode* node = link->load(memory_order_relaxed);
+    while (node != nullptr && (node->hashValue != hashValue || node->bid.bidId != bidId)) {
+        link = &(node->next);
+        node = link->load(memory_order_relaxed);
+    }
+    if (node == nullptr) {
+        return;
+    }
+
+    // readers already on the node still see its next pointer, so the
+    // unlink is one store and the node itself waits for reclamation
+    link->store(node->next.load(memory_order_relaxed));
+    size.fetch_sub(1, memory_order_relaxed);
+    if (funds != nullptr) {
+        funds->Remove(node->bid);
+    }
+    retired.push_back({ epochs.Advance(), node, nullptr });
+
+    if (retired.size() >= RECLAIM_BATCH) {
+        reclaim(false);
+    }
+}
+
+/**
+ * Find the bid with the specified bidId. A removed node is only freed
+ * once no reader can still see it, but that is over as soon as this
+ * call returns, so the bid is copied into a buffer kept by the calling
+ * thread, as ConcurrentHashTable::Find does.
+ *
+ * @param bidId The bid id to search for
+ * @return The copy, valid until this thread's next Find, nullptr if not found
+ */
+const Bid* LockFreeHashTable::Find(string_view bidId) {
+    static thread_local Bid found;
+    uint64_t hashValue = hashFunction(bidId);
+    bool matched = false;
+
+    epochs.Enter();
+    LfTable* current = table.load(memory_order_acquire);
+    LfNode* node = current->heads[bucketFor(hashValue, current->size)].load(memory_order_acquire);
+    while (node != nullptr) {
+        if (node->hashValue == hashValue && node->bid.bidId == bidId) {
+            found = node->bid;
+            matched = true;
+            break;
+        }
+        node = node->next.load(memory_order_acquire);
+    }
+    epochs.Exit();
+
+    return matched ? &found : nullptr;
+}
+
+/**
+ * Search for the specified bidId without taking any lock
+ *
+ * @param bidId The bid id to search for
+ */
+Bid LockFreeHashTable::Search(string bidId) {
+    Bid bid;
+    uint64_t hashValue = hashFunction(bidId);
+
+    epochs.Enter();
+    LfTable* current = table.load(memory_order_acquire);
+    LfNode* node = current->heads[bucketFor(hashValue, current->size)].load(memory_order_acquire);
+    while (node != nullptr) {
+        if (node->hashValue == hashValue && node->bid.bidId == bidId) {
+            bid = node->bid;
+            break;
+        }
+        node = node->next.load(memory_order_acquire);
+    }
+    epochs.Exit();
+
+    return bid;
+}
+
+/**
+ * Find many bids within one epoch, prefetching the buckets of a group
+ * of keys before walking any of their chains. Nodes may be freed once
+ * the epoch is left, so as with Find the bids are copied into buffers
+ * kept by the calling thread whose strings keep their capacity.
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until this thread's next SearchBatch.
+ */
+void LockFreeHashTable::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    static thread_local vector<Bid> found;
+    if (found.size() < bidIds.size()) {
+        found.resize(bidIds.size());
+    }
+    results.assign(bidIds.size(), nullptr);
+
+    uint64_t hashes[BATCH_GROUP];
+    epochs.Enter();
+    LfTable* current = table.load(memory_order_acquire);
+    for (size_t start = 0; start < bidIds.size(); start += BATCH_GROUP) {
+        size_t end = min(bidIds.size(), start + BATCH_GROUP);
+
+        for (size_t i = start; i < end; i++) {
+            hashes[i - start] = hashFunction(bidIds[i]);
+            PREFETCH(&(current->heads[bucketFor(hashes[i - start], current->size)]));
+        }
+
+        for (size_t i = start; i < end; i++) {
+            uint64_t hashValue = hashes[i - start];
+            LfNode* node = current->heads[bucketFor(hashValue, current->size)].load(memory_order_acquire);
+            while (node != nullptr) {
+                if (node->hashValue == hashValue && node->bid.bidId == bidIds[i]) {
+                    found[i] = node->bid;
+                    results[i] = &found[i];
+                    break;
+                }
+                node = node->next.load(memory_order_acquire);
+            }
+        }
+    }
+    epochs.Exit();
+}
+
+/**
+ * Returns a copy of every bid in the table
+ */
+vector<Bid> LockFreeHashTable::GetAllBids() {
+    vector<Bid> bids;
+    epochs.Enter();
+    LfTable* current = table.load(memory_order_acquire);
+    for (unsigned int i = 0; i < current->size; i++) {
+        LfNode* node = current->heads[i].load(memory_order_acquire);
+        while (node != nullptr) {
+            bids.push_back(node->bid);
+            node = node->next.load(memory_order_acquire);
+        }
+    }
+    epochs.Exit();
+    return bids;
+}
+
+/**
+ * Returns the average number of bids per bucket
+ */
+double LockFreeHashTable::LoadFactor() {
+    return (double) Size() / Capacity();
+}
+
+/**
+ * Returns the number of bids in the table
+ */
+unsigned int LockFreeHashTable::Size() {
+    return size.load(memory_order_relaxed);
+}
+
+/**
+ * Returns the number of buckets in the table
+ */
+unsigned int LockFreeHashTable::Capacity() {
+    return table.load(memory_order_acquire)->size;
+}
+
+/**
+ * Replace the hash function. Readers would look in the wrong buckets,
+ * so this is refused once any bid has been inserted.
+ *
+ * @param function The hash policy to use from now on
+ */
+void LockFreeHashTable::SetHashFunction(HashFunction function) {
+    lock_guard<mutex> guard(writeLock);
+    if (size.load(memory_order_relaxed) > 0) {
+        cout << "The hash function can only change while the table is empty." << endl;
+        return;
+    }
+    hashFunction = function;
+}
+
+//============================================================================
+// Perfect Hash Table class definition
+//============================================================================
+
+/**
+ * Define a class implementing a minimal perfect hash over a fixed set of
+ * bids (hash and displace, in the style of CHD/PTHash). Keys are split
+ * into small buckets and each bucket stores a 16 bit pilot chosen so that
+ * all of its keys land on free slots. A lookup is then one hash, one
+ * slot and one key compare, with no chains or probing, at about 4.3 bits
+ * of index per bid.
+ *
+ * Inserts and removes are staged and the index is rebuilt on the next
+ * lookup, so it suits a month's feed that is loaded once and then read.
+ */
+class PerfectHashTable : public HashTable {
+
+private:
+    vector<Bid> bids;            // in slot order once built
+    vector<uint16_t> pilots;     // one per bucket
+    vector<unsigned int> remap;  // final slot of positions past the last bid
+    unsigned int bucketCount = 0;
+    unsigned int positionCount = 0;
+    uint64_t seed = 0;
+    bool built = false;
+
+    unsigned int position(uint64_t hashValue, uint16_t pilot);
+    unsigned int slotFor(uint64_t hashValue);
+    bool tryBuild(const vector<uint64_t>& hashes, vector<unsigned int>& slots);
+
+public:
+    PerfectHashTable();
+    void Build();
+    void Insert(Bid bid);
+    void PrintAll();
+    void Remove(string bidId);
+    const Bid* Find(string_view bidId);
+    Bid Search(string bidId);
+    void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    vector<Bid> GetAllBids();
+    FundIndex& Funds();
+    double LoadFactor();
+    unsigned int Size();
+    unsigned int Capacity();
+    void SetHashFunction(HashFunction function);
+};
+
+/**
+ * Default constructor
+ */
+PerfectHashTable::PerfectHashTable() : HashTable(wyHash) {
+}
+
+/**
+ * Position a key would take with a given pilot, in [0, positionCount)
+ *
+ * @param hashValue The full hash of the key
+ * @param pilot The pilot of the key's bucket
+ */
+unsigned int PerfectHashTable::position(uint64_t hashValue, uint16_t pilot) {
+    uint64_t mixed = foldedMultiply(hashValue ^ seed, 0x9e3779b97f4a7c15ULL * (pilot + 1ULL));
+    return (unsigned int) (((mixed & 0xffffffff) * positionCount) >> 32);
+}
+
+/**
+ * Slot of a key in the built index, in [0, number of bids)
+ *
+ * @param hashValue The full hash of the key
+ */
+unsigned int PerfectHashTable::slotFor(uint64_t hashValue) {
+    unsigned int bucket = bucketFor(hashValue ^ seed, bucketCount);
+    unsigned int p = position(hashValue, pilots[bucket]);
+    if (p < bids.size()) {
+        return p;
+    }
+    return remap[p - bids.size()];
+}
+
+/**
+ * Try to find a pilot for every bucket with the current seed
+ *
+ * @param hashes Full hash of every bid
+ * @param slots Filled with the final slot of every bid
+ * @return false if some bucket has no working pilot
+ */
+bool PerfectHashTable::tryBuild(const vector<uint64_t>& hashes, vector<unsigned int>& slots) {
+    unsigned int count = (unsigned int) hashes.size();
+
+    // group the keys by bucket with a counting sort
+    vector<unsigned int> bucketStart(bucketCount + 1, 0);
+    vector<unsigned int> keyBucket(count);
+    for (unsigned int i = 0; i < count; i++) {
+        keyBucket[i] = bucketFor(hashes[i] ^ seed, bucketCount);
+        bucketStart[keyBucket[i] + 1]++;
+    }
+    for (unsigned int b = 0; b < bucketCount; b++) {
+        bucketStart[b + 1] += bucketStart[b];
+    }
+    vector<unsigned int> bucketKeys(count);
+    vector<unsigned int> fill(bucketStart.begin(), bucketStart.end() - 1);
+    for (unsigned int i = 0; i < count; i++) {
+        bucketKeys[fill[keyBucket[i]]++] = i;
+    }
+
+    // place the biggest buckets first while most positions are still free
+    vector<unsigned int> order(bucketCount);
+    for (unsigned int b = 0; b < bucketCount; b++) {
+        order[b] = b;
+    }
+    stable_sort(order.begin(), order.end(), [&bucketStart](unsigned int a, unsigned int b) {
+        return bucketStart[a + 1] - bucketStart[a] > bucketStart[b + 1] - bucketStart[b];
+    });
+
+    vector<bool> taken(positionCount, false);
+    vector<unsigned int> positions;
+    pilots.assign(bucketCount, 0);
+    for (unsigned int b : order) {
+        unsigned int first = bucketStart[b];
+        unsigned int last = bucketStart[b + 1];
+        if (first == last) {
+            continue;
+        }
+
+        bool placed = false;
+        for (unsigned int pilot = 0; pilot <= 0xffff && !placed; pilot++) {
+            positions.clear();
+            placed = true;
+            for (unsigned int k = first; k < last && placed; k++) {
+                unsigned int p = position(hashes[bucketKeys[k]], (uint16_t) pilot);
+                // the slot must be free and not used by another key of this bucket
+                if (taken[p] || find(positions.begin(), positions.end(), p) != positions.end()) {
+                    placed = false;
+                }
+                positions.push_back(p);
+            }
+            if (placed) {
+                pilots[b] = (uint16_t) pilot;
+                for (unsigned int k = first; k < last; k++) {
+                    taken[positions[k - first]] = true;
+                    slots[bucketKeys[k]] = positions[k - first];
+                }
+            }
+        }
+        if (!placed) {
+            return false;
+        }
+    }
+
+    // positions past the last bid are moved into the holes below it,
+    // which makes the hash minimal
+    remap.assign(positionCount - count, 0);
+    unsigned int hole = 0;
+    for (unsigned int p = count; p < positionCount; p++) {
+        if (taken[p]) {
+            while (taken[hole]) {
+                hole++;
+            }
+            remap[p - count] = hole++;
+        }
+    }
+    for (unsigned int i = 0; i < count; i++) {
+        if (slots[i] >= count) {
+            slots[i] = remap[slots[i] - count];
+        }
+    }
+    return true;
+}
+
+/**
+ * Build the index over the current bids
+ */
+void PerfectHashTable::Build() {
+    // drop duplicate ids, the first one inserted wins like the chaining table
+    stable_sort(bids.begin(), bids.end(), [](const Bid& a, const Bid& b) {
+        return a.bidId < b.bidId;
+    });
+    size_t kept = 0;
+    for (size_t i = 0; i < bids.size(); i++) {
+        if (kept > 0 && bids[i].bidId == bids[kept - 1].bidId) {
+            if (funds != nullptr) {
+                funds->Remove(bids[i]);
+            }
+            continue;
+        }
+        if (kept != i) {
+            bids[kept] = std::move(bids[i]);
+        }
+        kept++;
+    }
+    bids.resize(kept);
+
+    unsigned int count = (unsigned int) bids.size();
+    bucketCount = count / PERFECT_BUCKET_KEYS + 1;
+    positionCount = count + count / 100 + 1;
+
+    // hashing is independent per key so split it across threads
+    vector<uint64_t> hashes(count);
+    unsigned int threads = count < 100000 ? 1 : max(1u, thread::hardware_concurrency());
+    vector<thread> workers;
+    for (unsigned int t = 0; t < threads; t++) {
+        workers.push_back(thread([this, &hashes, t, threads, count]() {
+            for (unsigned int i = t; i < count; i += threads) {
+                hashes[i] = hashFunction(bids[i].bidId);
+            }
+        }));
+    }
+    for (thread& worker : workers) {
+        worker.join();
+    }
+
+    // a bucket with no working pilot is very unlikely, a new seed fixes it
+    vector<unsigned int> slots(count);
+    for (seed = 0; !tryBuild(hashes, slots); seed += 0x9e3779b97f4a7c15ULL) {
+    }
+
+    vector<Bid> ordered(count);
+    for (unsigned int i = 0; i < count; i++) {
+        ordered[slots[i]] = move(bids[i]);
+    }
+    bids.swap(ordered);
+    built = true;
+}
+
+/**
+ * Stage a bid, the index is rebuilt on the next lookup
+ *
+ * @param bid The bid to insert
+ */
+void PerfectHashTable::Insert(Bid bid) {
+    bids.push_back(bid);
+    built = false;
+    if (funds != nullptr) {
+        funds->Insert(bids.back());
+    }
+}
+
+/**
+ * Print all bids in slot order
+ */
+void PerfectHashTable::PrintAll() {
+    if (!built) {
+        Build();
+    }
+    for (unsigned int i = 0; i < bids.size(); i++) {
+        cout << "Key " << i << ": " << bids[i].bidId << " | " << bids[i].title << " | " << bids[i].fund << endl;
+    }
+}
+
+/**
+ * Remove a bid, the index is rebuilt on the next lookup
+ *
+ * @param bidId The bid id to search for
+ */
+void PerfectHashTable::Remove(string bidId) {
+    if (!built) {
+        Build();
+    }
+    if (bids.empty()) {
+        return;
+    }
+    unsigned int slot = slotFor(hashFunction(bidId));
+    if (bids[slot].bidId == bidId) {
+        if (funds != nullptr) {
+            funds->Remove(bids[slot]);
+        }
+        bids.erase(bids.begin() + slot);
+        built = false;
+    }
+}
+
+/**
+ * Find the bid with the specified bidId without copying it
+ *
+ * @param bidId The bid id to search for
+ * @return The bid in its slot, nullptr if not found. It stays valid
+ *         until the next insert or remove.
+ */
+const Bid* PerfectHashTable::Find(string_view bidId) {
+    if (!built) {
+        Build();
+    }
+
+    // every id maps to some slot, compare to tell hits from misses
+    if (!bids.empty()) {
+        unsigned int slot = slotFor(hashFunction(bidId));
+        if (bids[slot].bidId == bidId) {
+            return &bids[slot];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * Search for the specified bidId with a single slot probe
+ *
+ * @param bidId The bid id to search for
+ */
+Bid PerfectHashTable::Search(string bidId) {
+    const Bid* found = Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+    Bid bid;
+    return bid;
+}
+
+/**
+ * Find many bids at once without copying them, prefetching each slot
+ * before comparing
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until the next insert or remove.
+ */
+void PerfectHashTable::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    if (!built) {
+        Build();
+    }
+    results.assign(bidIds.size(), nullptr);
+    if (bids.empty()) {
+        return;
+    }
+
+    unsigned int slots[BATCH_GROUP];
+    for (size_t start = 0; start < bidIds.size(); start += BATCH_GROUP) {
+        size_t end = min(bidIds.size(), start + BATCH_GROUP);
+        for (size_t i = start; i < end; i++) {
+            slots[i - start] = slotFor(hashFunction(bidIds[i]));
+            PREFETCH(&bids[slots[i - start]]);
+        }
+        for (size_t i = start; i < end; i++) {
+            if (bids[slots[i - start]].bidId == bidIds[i]) {
+                results[i] = &bids[slots[i - start]];
+            }
+        }
+    }
+}
+
+/**
+ * Returns a copy of every bid in the table, in slot order
+ */
+vector<Bid> PerfectHashTable::GetAllBids() {
+    if (!built) {
+        Build();
+    }
+    return bids;
+}
+
+/**
+ * Builds first so duplicates still staged are out of the fund index
+ */
+FundIndex& PerfectHashTable::Funds() {
+    if (!built) {
+        Build();
+    }
+    return HashTable::Funds();
+}
+
+/**
+ * Returns 1, every slot holds a bid
+ */
+double PerfectHashTable::LoadFactor() {
+    return bids.empty() ? 0.0 : 1.0;
+}
+
+/**
+ * Returns the number of bids in the table
+ */
+unsigned int PerfectHashTable::Size() {
+    if (!built) {
+        Build();
+    }
+    return (unsigned int) bids.size();
+}
+
+/**
+ * Returns the number of slots, the same as the number of bids
+ */
+unsigned int PerfectHashTable::Capacity() {
+    return Size();
+}
+
+/**
+ * Replace the hash function, the index is rebuilt on the next lookup
+ *
+ * @param function The hash policy to use from now on
+ */
+void PerfectHashTable::SetHashFunction(HashFunction function) {
+    hashFunction = function;
+    built = false;
+}
+
+//============================================================================
+// Mapped Hash Table class definition
+//============================================================================
+
+/**
+ * Define a class that answers searches straight from an index file
+ * mapped into memory, so a short-lived process skips loading the CSV.
+ * Only the pages a search touches are ever read from disk.
+ *
+ * File layout, in the byte order of the machine that wrote it, so an
+ * index is only read back on a machine with the same byte order:
+ *   IndexHeader
+ *   IndexSlot[slotCount]  open addressing, linear probing, wyHash
+ *   string arena          bid ids, titles and funds back to back
+ */
+class MappedHashTable : public HashTable {
+
+private:
+    struct IndexHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+        uint32_t slotCount; // a power of two
+        uint32_t reserved;
+        uint64_t arenaSize;
+        uint64_t checksum; // FNV-1a of the slots and arena
+    };
+
+    struct IndexSlot {
+        uint64_t hashValue;
+        double amount;
+        uint32_t idOffset;
+        uint32_t titleOffset;
+        uint32_t fundOffset;
+        uint16_t idLength;
+        uint16_t titleLength;
+        uint16_t fundLength;
+        uint16_t used;
+        uint32_t reserved;
+    };
+
+    static const uint32_t INDEX_VERSION = 1;
+
+    const unsigned char* data = nullptr;
+    size_t length = 0;
+    const IndexHeader* header = nullptr;
+    const IndexSlot* slots = nullptr;
+    const char* arena = nullptr;
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+
+    static uint64_t checksum(const unsigned char* bytes, size_t count);
+    bool inArena(const IndexSlot& slot);
+    Bid bidAt(const IndexSlot& slot);
+    void copyBid(const IndexSlot& slot, Bid& bid);
+    const IndexSlot* findSlot(string_view bidId, uint64_t hashValue);
+    void close();
+
+public:
+    MappedHashTable();
+    virtual ~MappedHashTable();
+    static bool Write(string path, const vector<Bid>& bids);
+    bool Open(string path);
+    bool Verify();
+    void Insert(Bid bid);
+    void PrintAll();
+    void Remove(string bidId);
+    const Bid* Find(string_view bidId);
+    Bid Search(string bidId);
+    void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    vector<Bid> GetAllBids();
+    double LoadFactor();
+    unsigned int Size();
+    unsigned int Capacity();
+    void SetHashFunction(HashFunction function);
+};
+
+/**
+ * Default constructor, the file format always uses wyHash
+ */
+MappedHashTable::MappedHashTable() : HashTable(wyHash) {
+}
+
+/**
+ * Destructor
+ */
+MappedHashTable::~MappedHashTable() {
+    close();
+}
+
+/**
+ * FNV-1a over a block of bytes, used to detect a damaged file
+ */
+uint64_t MappedHashTable::checksum(const unsigned char* bytes, size_t count) {
+    uint64_t hashValue = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < count; i++) {
+        hashValue ^= bytes[i];
+        hashValue *= 0x100000001b3ULL;
+    }
+    return hashValue;
+}
+
+/**
+ * Write bids out as an index file
+ *
+ * @param path The file to create
+ * @param bids The bids to store, later duplicates of an id are skipped
+ * @return true if the file was written, false if it could not be or if
+ *         the bids do not fit the format's 32 bit counts and offsets or
+ *         16 bit id lengths
+ */
+bool MappedHashTable::Write(string path, const vector<Bid>& bids) {
+    // keep the table at most half full so probes stay short
+    uint64_t tableSize = 2;
+    while (tableSize < (uint64_t) bids.size() * 2) {
+        tableSize *= 2;
+    }
+    if (tableSize > UINT32_MAX) {
+        return false;
+    }
+    uint32_t slotCount = (uint32_t) tableSize;
+
+    vector<IndexSlot> slotTable(slotCount);
+    memset(slotTable.data(), 0, slotCount * sizeof(IndexSlot));
+    string arenaBytes;
+    uint32_t count = 0;
+
+    for (const Bid& bid : bids) {
+        // an id cut short could match another one, so it is not stored at all
+        if (bid.bidId.size() > 0xffff) {
+            return false;
+        }
+        uint64_t hashValue = wyHash(bid.bidId);
+        uint32_t i = (uint32_t) hashValue & (slotCount - 1);
+        bool duplicate = false;
+        while (slotTable[i].used) {
+            if (slotTable[i].hashValue == hashValue
+                    && arenaBytes.compare(slotTable[i].idOffset, slotTable[i].idLength, bid.bidId) == 0) {
+                duplicate = true;
+                break;
+            }
+            i = (i + 1) & (slotCount - 1);
+        }
+        if (duplicate) {
+            continue;
+        }
+
+        // titles and funds longer than a slot can describe are cut short,
+        // and every offset must fit in 32 bits
+        size_t titleLength = min<size_t>(bid.title.size(), 0xffff);
+        size_t fundLength = min<size_t>(bid.fund.size(), 0xffff);
+        if ((uint64_t) arenaBytes.size() + bid.bidId.size() + titleLength + fundLength > UINT32_MAX) {
+            return false;
+        }
+        IndexSlot& slot = slotTable[i];
+        slot.hashValue = hashValue;
+        slot.amount = bid.amount;
+        slot.used = 1;
+        slot.idOffset = (uint32_t) arenaBytes.size();
+        slot.idLength = (uint16_t) bid.bidId.size();
+        arenaBytes.append(bid.bidId);
+        slot.titleOffset = (uint32_t) arenaBytes.size();
+        slot.titleLength = (uint16_t) titleLength;
+        arenaBytes.append(bid.title, 0, titleLength);
+        slot.fundOffset = (uint32_t) arenaBytes.size();
+        slot.fundLength = (uint16_t) fundLength;
+        arenaBytes.append(bid.fund, 0, fundLength);
+        count++;
+    }
+
+    IndexHeader fileHeader;
+    memset(&fileHeader, 0, sizeof(fileHeader));
+    memcpy(fileHeader.magic, "BIDINDEX", 8);
+    fileHeader.version = INDEX_VERSION;
+    fileHeader.count = count;
+    fileHeader.slotCount = slotCount;
+    fileHeader.arenaSize = arenaBytes.size();
+
+    // one checksum over the slots followed by the arena
+    uint64_t hashValue = checksum((const unsigned char*) slotTable.data(), slotCount * sizeof(IndexSlot));
+    for (unsigned char c : arenaBytes) {
+        hashValue ^= c;
+        hashValue *= 0x100000001b3ULL;
+    }
+    fileHeader.checksum = hashValue;
+
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write((const char*) &fileHeader, sizeof(fileHeader));
+    out.write((const char*) slotTable.data(), slotCount * sizeof(IndexSlot));
+    out.write(arenaBytes.data(), arenaBytes.size());
+    return out.good();
+}
+
+/**
+ * Map an index file into memory. Only the header is read here, so
+ * opening costs the same for any size of file. Each slot is checked
+ * when a lookup reads it.
+ *
+ * @param path The index file to open
+ * @return true if the file is a valid index
+ */
+bool MappedHashTable::Open(string path) {
+    close();
+
+#ifdef _WIN32
+    file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(file, &fileSize);
+    length = (size_t) fileSize.QuadPart;
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL) {
+        data = (const unsigned char*) MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    }
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        length = (size_t) info.st_size;
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+        data = mapped == MAP_FAILED ? nullptr : (const unsigned char*) mapped;
+    }
+    // the mapping stays valid after the descriptor is closed
+    ::close(fd);
+#endif
+
+    if (data == nullptr || length < sizeof(IndexHeader)) {
+        close();
+        return false;
+    }
+
+    header = (const IndexHeader*) data;
+    size_t expected = sizeof(IndexHeader) + (size_t) header->slotCount * sizeof(IndexSlot) + header->arenaSize;
+    if (memcmp(header->magic, "BIDINDEX", 8) != 0 || header->version != INDEX_VERSION
+            || header->slotCount == 0 || (header->slotCount & (header->slotCount - 1)) != 0
+            || length != expected) {
+        close();
+        return false;
+    }
+
+    slots = (const IndexSlot*) (data + sizeof(IndexHeader));
+    arena = (const char*) (slots + header->slotCount);
+    return true;
+}
+
+/**
+ * Check the whole file: the checksum, the used slots against the
+ * header's count, and that a slot is left free so a missed probe stops.
+ * This reads every page, so it is kept out of Open.
+ *
+ * @return true if the file is intact
+ */
+bool MappedHashTable::Verify() {
+    if (header == nullptr) {
+        return false;
+    }
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < header->slotCount; i++) {
+        if (slots[i].used) {
+            if (!inArena(slots[i])) {
+                return false;
+            }
+            used++;
+        }
+    }
+    if (used != header->count || used >= header->slotCount) {
+        return false;
+    }
+    return checksum(data + sizeof(IndexHeader), length - sizeof(IndexHeader)) == header->checksum;
+}
+
+/**
+ * Unmap the current file, if any
+ */
+void MappedHashTable::close() {
+#ifdef _WIN32
+    if (data != nullptr) {
+        UnmapViewOfFile(data);
+    }
+    if (mapping != NULL) {
+        CloseHandle(mapping);
+    }
+    if (file != INVALID_HANDLE_VALUE) {
+        CloseHandle(file);
+    }
+    mapping = NULL;
+    file = INVALID_HANDLE_VALUE;
+#else
+    if (data != nullptr) {
+        munmap((void*) data, length);
+    }
+#endif
+    data = nullptr;
+    length = 0;
+    header = nullptr;
+    slots = nullptr;
+    arena = nullptr;
+}
+
+/**
+ * Returns true if every string a slot points at lies inside the arena,
+ * so a damaged slot cannot send a read outside the mapping
+ */
+bool MappedHashTable::inArena(const IndexSlot& slot) {
+    uint64_t arenaSize = header->arenaSize;
+    return (uint64_t) slot.idOffset + slot.idLength <= arenaSize
+            && (uint64_t) slot.titleOffset + slot.titleLength <= arenaSize
+            && (uint64_t) slot.fundOffset + slot.fundLength <= arenaSize;
+}
+
+/**
+ * Copy the bid described by a slot out of the arena
+ */
+Bid MappedHashTable::bidAt(const IndexSlot& slot) {
+    Bid bid;
+    copyBid(slot, bid);
+    return bid;
+}
+
+/**
+ * Copy the bid described by a slot out of the arena into an existing
+ * bid, reusing the memory its strings already hold. The slot must have
+ * passed inArena.
+ */
+void MappedHashTable::copyBid(const IndexSlot& slot, Bid& bid) {
+    bid.bidId.assign(arena + slot.idOffset, slot.idLength);
+    bid.title.assign(arena + slot.titleOffset, slot.titleLength);
+    bid.fund.assign(arena + slot.fundOffset, slot.fundLength);
+    bid.amount = slot.amount;
+}
+
+/**
+ * Find the slot holding bidId
+ *
+ * @param bidId The bid id to search for
+ * @param hashValue wyHash of bidId
+ * @return The slot or nullptr if not found
+ */
+const MappedHashTable::IndexSlot* MappedHashTable::findSlot(string_view bidId, uint64_t hashValue) {
+    if (header == nullptr) {
+        return nullptr;
+    }
+    // a damaged file may have no free slot, the cap keeps the loop finite
+    uint32_t mask = header->slotCount - 1;
+    uint32_t i = (uint32_t) hashValue & mask;
+    for (uint32_t probes = 0; probes < header->slotCount && slots[i].used; probes++, i = (i + 1) & mask) {
+        if (slots[i].hashValue == hashValue && slots[i].idLength == bidId.size() && inArena(slots[i])
+                && memcmp(arena + slots[i].idOffset, bidId.data(), bidId.size()) == 0) {
+            return &slots[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * The file is read-only, bids are added by writing a new index file
+ */
+void MappedHashTable::Insert(Bid) {
+    cout << "The index file is read-only, save a new one to add bids." << endl;
+}
+
+/**
+ * Print all bids
+ */
+void MappedHashTable::PrintAll() {
+    for (uint32_t i = 0; header != nullptr && i < header->slotCount; i++) {
+        if (slots[i].used && inArena(slots[i])) {
+            Bid bid = bidAt(slots[i]);
+            cout << "Key " << i << ": " << bid.bidId << " | " << bid.title << " | " << bid.fund << endl;
+        }
+    }
+}
+
+/**
+ * The file is read-only, bids are removed by writing a new index file
+ */
+void MappedHashTable::Remove(string) {
+    cout << "The index file is read-only, save a new one to remove bids." << endl;
+}
+
+/**
+ * Find the bid with the specified bidId. The file holds the bid's
+ * fields packed in its arena rather than as a Bid, so it is copied into
+ * a buffer kept by the calling thread whose strings keep their capacity
+ * between finds.
+ *
+ * @param bidId The bid id to search for
+ * @return The copy, valid until this thread's next Find, nullptr if not found
+ */
+const Bid* MappedHashTable::Find(string_view bidId) {
+    static thread_local Bid found;
+    const IndexSlot* slot = findSlot(bidId, wyHash(bidId));
+    if (slot == nullptr) {
+        return nullptr;
+    }
+    copyBid(*slot, found);
+    return &found;
+}
+
+/**
+ * Search for the specified bidId
+ *
+ * @param bidId The bid id to search for
+ */
+Bid MappedHashTable::Search(string bidId) {
+    const IndexSlot* slot = findSlot(bidId, wyHash(bidId));
+    if (slot == nullptr) {
+        Bid bid;
+        return bid;
+    }
+    return bidAt(*slot);
+}
+
+/**
+ * Find many bids at once, prefetching each first slot before probing.
+ * As with Find the bids are copied out of the arena, into buffers kept
+ * by the calling thread whose strings keep their capacity.
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until this thread's next SearchBatch.
+ */
+void MappedHashTable::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    static thread_local vector<Bid> found;
+    results.assign(bidIds.size(), nullptr);
+    if (header == nullptr) {
+        return;
+    }
+    if (found.size() < bidIds.size()) {
+        found.resize(bidIds.size());
+    }
+
+    uint64_t hashes[BATCH_GROUP];
+    for (size_t start = 0; start < bidIds.size(); start += BATCH_GROUP) {
+        size_t end = min(bidIds.size(), start + BATCH_GROUP);
+        for (size_t i = start; i < end; i++) {
+            hashes[i - start] = wyHash(bidIds[i]);
+            PREFETCH(&slots[(uint32_t) hashes[i - start] & (header->slotCount - 1)]);
+        }
+        for (size_t i = start; i < end; i++) {
+            const IndexSlot* slot = findSlot(bidIds[i], hashes[i - start]);
+            if (slot != nullptr) {
+                copyBid(*slot, found[i]);
+                results[i] = &found[i];
+            }
+        }
+    }
+}
+
+/**
+ * Returns a copy of every bid in the file, in slot order
+ */
+vector<Bid> MappedHashTable::GetAllBids() {
+    vector<Bid> bids;
+    for (uint32_t i = 0; header != nullptr && i < header->slotCount; i++) {
+        if (slots[i].used && inArena(slots[i])) {
+            bids.push_back(bidAt(slots[i]));
+        }
+    }
+    return bids;
+}
+
+/**
+ * Returns the fraction of slots holding a bid
+ */
+double MappedHashTable::LoadFactor() {
+    return header == nullptr ? 0.0 : (double) header->count / header->slotCount;
+}
+
+/**
+ * Returns the number of bids in the file
+ */
+unsigned int MappedHashTable::Size() {
+    return header == nullptr ? 0 : header->count;
+}
+
+/**
+ * Returns the number of slots in the file
+ */
+unsigned int MappedHashTable::Capacity() {
+    return header == nullptr ? 0 : header->slotCount;
+}
+
+/**
+ * The file format fixes the hash function to wyHash, so it cannot change
+ */
+void MappedHashTable::SetHashFunction(HashFunction) {
+    cout << "The index file always uses wyHash, its hash function cannot change." << endl;
+}
+
+/**
+ * Write every bid in the table out as an index file that
+ * MappedHashTable can open later
+ *
+ * @param path The file to create
+ * @return true if the file was written
+ */
+bool HashTable::WriteIndex(string path) {
+    return MappedHashTable::Write(path, GetAllBids());
+}
+
+//============================================================================
+// Typed Hash Table template definition
+//============================================================================
+
+/**
+ * Hash policy object for the typed table, calling it through a type
+ * instead of a function pointer lets the compiler inline it
+ */
+struct WyHasher {
+    uint64_t operator()(const string& key) const {
+        return wyHash(key);
+    }
+};
+
+/**
+ * Reduce a 32 bit value modulo a divisor only known at runtime with two
+ * multiplies instead of a division (Lemire's fastmod). The constant
+ * M = 2^64 / d + 1 is computed once when the divisor changes, then
+ * a % d is the high 64 bits of (M * a mod 2^64) * d.
+ */
+struct FastModulo {
+    uint64_t multiplier = 0;
+    uint32_t divisor = 1;
+
+    void SetDivisor(uint32_t d) {
+        divisor = d;
+        // wraps to 0 for d == 1, which still reduces everything to 0
+        multiplier = UINT64_MAX / d + 1;
+    }
+
+    uint32_t Reduce(uint32_t a) const {
+        uint64_t lowBits = multiplier * a;
+        // high half of the 96 bit product lowBits * divisor
+        return (uint32_t) (((lowBits >> 32) * divisor + (((lowBits & 0xffffffff) * divisor) >> 32)) >> 32);
+    }
+};
+
+/**
+ * Hash table specialized at compile time for its key, value and hash
+ * types, with no virtual calls. With a FixedCapacity the slot count is a
+ * constant, so the compiler turns the modulo into a multiply (or a mask
+ * for a power of two) and the table never grows; Insert fails once it
+ * is full. With FixedCapacity 0 the table grows and reduces with FastModulo.
+ *
+ * Collisions are resolved with linear probing and removal shifts the
+ * following entries back, so there are no tombstones.
+ */
+template <class Key, class Value, class Hash = WyHasher, unsigned int FixedCapacity = 0>
+class BasicHashTable {
+
+private:
+    struct Slot {
+        Key key;
+        Value value;
+        bool full = false;
+    };
+
+    vector<Slot> slots;
+    unsigned int size = 0;
+    FastModulo modulo;
+    Hash hasher;
+
+    unsigned int home(const Key& key) const {
+        uint64_t hashValue = hasher(key);
+        if (FixedCapacity != 0) {
+            return (unsigned int) (hashValue % FixedCapacity);
+        }
+        return modulo.Reduce((uint32_t) (hashValue >> 32));
+    }
+
+    unsigned int next(unsigned int slot) const {
+        return slot + 1 == slots.size() ? 0 : slot + 1;
+    }
+
+    void grow();
+
+public:
+    BasicHashTable(unsigned int size = DEFAULT_SIZE);
+    bool Insert(const Key& key, const Value& value);
+    bool Remove(const Key& key);
+    const Value* Search(const Key& key) const;
+    unsigned int Size() const;
+    unsigned int Capacity() const;
+    double LoadFactor() const;
 };
 
 /**
- * Default constructor
+ * Constructor, the size is ignored when the capacity is fixed
+ *
+ * @param size Initial number of slots
  */
-HashTable::HashTable() {
-    // FIXME (1): Initialize the structures used to hold bids
-    // Initalize node structure by resizing tableSize
-    nodes.resize(DEFAULT_SIZE); // Default size if no size is given
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+BasicHashTable<Key, Value, Hash, FixedCapacity>::BasicHashTable(unsigned int size) {
+    slots.resize(FixedCapacity != 0 ? FixedCapacity : max(size, 1u));
+    modulo.SetDivisor((uint32_t) slots.size());
 }
 
 /**
- * Constructor for specifying size of the table
- * Use to improve efficiency of hashing algorithm
- * by reducing collisions without wasting memory.
+ * Double the number of slots and reinsert every entry
  */
-HashTable::HashTable(unsigned int size) {
-    // invoke local tableSize to size with this->
-    // resize nodes size
-    this->tableSize = size;
-    nodes.resize(size);
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+void BasicHashTable<Key, Value, Hash, FixedCapacity>::grow() {
+    vector<Slot> oldSlots;
+    oldSlots.swap(slots);
+    slots.resize(oldSlots.size() * 2 + 1);
+    modulo.SetDivisor((uint32_t) slots.size());
+    size = 0;
+    for (Slot& slot : oldSlots) {
+        if (slot.full) {
+            Insert(slot.key, slot.value);
+        }
+    }
 }
 
-
 /**
- * Destructor
+ * Insert a value, replacing the value of a key that is already present
+ *
+ * @param key The key to store under
+ * @param value The value to store
+ * @return false if the table has a fixed capacity and is full
  */
-HashTable::~HashTable() {
-    // FIXME (2): Implement logic to free storage when class is destroyed
-    // erase nodes beginning
-    nodes.erase(nodes.begin());
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+bool BasicHashTable<Key, Value, Hash, FixedCapacity>::Insert(const Key& key, const Value& value) {
+    // keep at least 1/8 of the slots empty so probes stay short
+    if (FixedCapacity == 0 && (size + 1) * 8 > slots.size() * 7) {
+        grow();
+    }
+
+    unsigned int slot = home(key);
+    for (unsigned int probes = 0; probes < slots.size(); probes++) {
+        if (!slots[slot].full) {
+            slots[slot].key = key;
+            slots[slot].value = value;
+            slots[slot].full = true;
+            size++;
+            return true;
+        }
+        if (slots[slot].key == key) {
+            slots[slot].value = value;
+            return true;
+        }
+        slot = next(slot);
+    }
+    return false;
 }
 
 /**
- * Calculate the hash value of a given key.
- * Note that key is specifically defined as
- * unsigned int to prevent undefined results
- * of a negative list index.
+ * Remove a key, moving later entries of the probe run back into the gap
  *
- * @param key The key to hash
- * @return The calculated hash
+ * @param key The key to remove
+ * @return true if the key was found
  */
-unsigned int HashTable::hash(int key) {
-    // FIXME (3): Implement logic to calculate a hash value
-    return key % tableSize;
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+bool BasicHashTable<Key, Value, Hash, FixedCapacity>::Remove(const Key& key) {
+    unsigned int gap = home(key);
+    unsigned int probes = 0;
+    while (!(slots[gap].full && slots[gap].key == key)) {
+        if (!slots[gap].full || ++probes == slots.size()) {
+            return false;
+        }
+        gap = next(gap);
+    }
+
+    // the emptied gap also ends the scan when the table is full
+    slots[gap] = Slot();
+    for (unsigned int slot = next(gap); slots[slot].full; slot = next(slot)) {
+        // an entry may move back only if its home is not between the gap and it
+        unsigned int start = home(slots[slot].key);
+        bool between = gap < slot ? (start > gap && start <= slot) : (start > gap || start <= slot);
+        if (!between) {
+            slots[gap] = std::move(slots[slot]);
+            slots[slot] = Slot();
+            gap = slot;
+        }
+    }
+    size--;
+    return true;
 }
 
 /**
- * Insert a bid
+ * Search for a key
  *
- * @param bid The bid to insert
+ * @param key The key to look for
+ * @return Pointer to the stored value, or nullptr if it is not present
  */
-void HashTable::Insert(Bid bid) {
-    // FIXME (5): Implement logic to insert a bid
-    // create the key for the given bid
-    unsigned key = hash(atoi(bid.bidId.c_str()));
-
-    // try and retrieve node using key
-    Node* oldNode = &(nodes.at(key));
- 
-    // if no entry found for the key
-    if (oldNode == nullptr) {
-        // assign this node to the key position
-        Node* newNode = new Node(bid, key);
-        nodes.insert(nodes.begin() + key, *newNode);
-    }
-    // else if node is not used
-    else {
-        // assing old node key to UNIT_MAX, set to key, set old node to bid and old node next to null pointer
-        if (oldNode->key == UINT_MAX) {
-            oldNode->key = key;
-            oldNode->bid = bid;
-            oldNode->next = nullptr;
-        }
-        // else find the next open node
-        else {
-            // add new newNode to end
-            while (oldNode->next != nullptr) {
-                oldNode = oldNode->next;
-            }
-            oldNode->next = new Node(bid, key);
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+const Value* BasicHashTable<Key, Value, Hash, FixedCapacity>::Search(const Key& key) const {
+    unsigned int slot = home(key);
+    for (unsigned int probes = 0; probes < slots.size() && slots[slot].full; probes++) {
+        if (slots[slot].key == key) {
+            return &slots[slot].value;
         }
+        slot = next(slot);
     }
+    return nullptr;
 }
 
 /**
- * Print all bids
+ * Returns the number of entries in the table
  */
-void HashTable::PrintAll() {
-    // FIXME (6): Implement logic to print all bids
-    // for node begin to end iterate
-    for (auto i = nodes.begin(); i != nodes.end(); i++) {
-        // if key not equal to UINT_MAx
-        if (i->key != UINT_MAX) {
-            // output key, bidID, title, amount and fund
-            cout << "Key " << i->key << ": " << i->bid.bidId << " | " << i->bid.title << " | " << i->bid.fund << endl;
-            // node is equal to next iter
-            Node* tempNode = i->next;
-            // while node not equal to nullptr
-            while (tempNode != nullptr) {
-                // output key, bidID, title, amount and fund
-                cout << "Key " << tempNode->key << ": " << tempNode->bid.bidId << " | " << tempNode->bid.title << " | " << tempNode->bid.fund << endl;
-                // node is equal to next node
-                tempNode = tempNode->next;
-            }
-         }
-    }
-
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+unsigned int BasicHashTable<Key, Value, Hash, FixedCapacity>::Size() const {
+    return size;
 }
 
 /**
- * Remove a bid
- *
- * @param bidId The bid id to search for
+ * Returns the number of entries the table has slots for
  */
-void HashTable::Remove(string bidId) {
-    // FIXME (7): Implement logic to remove a bid
-    // set key equal to hash atoi bidID cstring
-    unsigned key = hash(atoi(bidId.c_str()));
-    // erase node begin and key
-    nodes.erase(nodes.begin() + key);
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+unsigned int BasicHashTable<Key, Value, Hash, FixedCapacity>::Capacity() const {
+    return (unsigned int) slots.size();
 }
 
 /**
- * Search for the specified bidId
- *
- * @param bidId The bid id to search for
+ * Returns the share of slots in use
  */
-Bid HashTable::Search(string bidId) {
-    Bid bid;
-
-    // FIXME (8): Implement logic to search for and return a bid
-
-    // create the key for the given bid
-    unsigned key = hash(atoi(bidId.c_str()));
-
-    // try and retrieve node using key
-    Node* node = &(nodes.at(key));
-
-    // if entry found for the key
-    if (node != nullptr && node->key != UINT_MAX && node->bid.bidId.compare(bidId) == 0) {
-         //return node bid
-        return node->bid;
-    }
-    // if no entry found for the key
-    if (node == nullptr || node->key == UINT_MAX) {
-        // return bid
-        return bid;
-    }
-    // while node not equal to nullptr
-    while (node != nullptr) {
-        // if the current node matches, return it
-        if (node->key != UINT_MAX && node->bid.bidId.compare(bidId) == 0) {
-            return node->bid;
-        }
-        //node is equal to next node
-        node = node->next;
-    }   
-
-    return bid;
+template <class Key, class Value, class Hash, unsigned int FixedCapacity>
+double BasicHashTable<Key, Value, Hash, FixedCapacity>::LoadFactor() const {
+    return (double) size / slots.size();
 }
 
 //============================================================================
@@ -254,17 +3507,72 @@ Bid HashTable::Search(string bidId) {
  *
  * @param bid struct containing the bid info
  */
-void displayBid(Bid bid) {
+void displayBid(const Bid& bid) {
     cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | "
             << bid.fund << endl;
     return;
 }
 
+/**
+ * Display the statistics of a table
+ *
+ * @param stats Snapshot taken with GetStats
+ */
+void displayStats(TableStats stats) {
+    cout << "Bids: " << stats.bids << " | Buckets: " << stats.buckets
+            << " | Used buckets: " << stats.usedBuckets << " | Tombstones: " << stats.tombstones << endl;
+    cout << "Load factor: " << stats.loadFactor << " | Longest chain/probe: " << stats.maxChain
+            << " | Bytes used: " << stats.bytesUsed << endl;
+    for (unsigned int length = 0; length < stats.chainHistogram.size(); length++) {
+        if (stats.chainHistogram[length] != 0) {
+            cout << "  length " << length << ": " << stats.chainHistogram[length] << endl;
+        }
+    }
+#if HASHTABLE_STATS
+    cout << "Hits: " << stats.hits << " | Misses: " << stats.misses << " | Key compares: " << stats.keyCompares
+            << " | Inserts: " << stats.inserts << " | Removes: " << stats.removes << endl;
+#endif
+    return;
+}
+
+/**
+ * List the funds with their bid counts, then display every bid of the
+ * fund the user picks
+ *
+ * @param hashTable The table holding the bids
+ */
+void listFundBids(HashTable* hashTable) {
+    FundIndex& funds = hashTable->Funds();
+    for (string fund : funds.Funds()) {
+        cout << fund << ": " << funds.Count(fund) << " bids" << endl;
+    }
+
+    // fund names contain spaces, so read the whole line
+    string fund;
+    cout << "Enter fund: ";
+    cin >> ws;
+    getline(cin, fund);
+
+    clock_t ticks = clock();
+    vector<string> bidIds = funds.BidIds(fund);
+    vector<const Bid*> bids;
+    hashTable->SearchBatch(bidIds, bids);
+    ticks = clock() - ticks;
+
+    for (const Bid* bid : bids) {
+        if (bid != nullptr) {
+            displayBid(*bid);
+        }
+    }
+    cout << bids.size() << " bids for fund " << fund << endl;
+    cout << "time: " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+}
+
 /**
  * Load a CSV file containing bids into a container
  *
  * @param csvPath the path to the CSV file to load
- * @return a container holding all the bids read
+ * @param hashTable the container to fill
  */
 void loadBids(string csvPath, HashTable* hashTable) {
     cout << "Loading CSV file " << csvPath << endl;
@@ -300,6 +3608,390 @@ void loadBids(string csvPath, HashTable* hashTable) {
     }
 }
 
+/**
+ * Print percentiles and a power of two histogram of operation latencies
+ *
+ * @param label Name of the operation measured
+ * @param latencies Nanoseconds taken by each operation
+ */
+void printLatencies(string label, vector<long long> latencies) {
+    sort(latencies.begin(), latencies.end());
+    size_t count = latencies.size();
+    if (count == 0) {
+        return;
+    }
+
+    cout << label << ": p50 " << latencies[count / 2] << " ns"
+            << " | p99 " << latencies[count * 99 / 100] << " ns"
+            << " | p99.9 " << latencies[count * 999 / 1000] << " ns"
+            << " | max " << latencies[count - 1] << " ns" << endl;
+
+    // count operations in each [2^b, 2^(b+1)) nanosecond bucket
+    vector<size_t> histogram(64, 0);
+    for (long long ns : latencies) {
+        unsigned int b = 0;
+        while (b < 63 && (1LL << (b + 1)) <= ns) {
+            b++;
+        }
+        histogram[b]++;
+    }
+    for (unsigned int b = 0; b < histogram.size(); b++) {
+        if (histogram[b] != 0) {
+            cout << "  < " << (1LL << (b + 1)) << " ns: " << histogram[b] << endl;
+        }
+    }
+}
+
+/**
+ * Time every insert and search while filling a fresh table, once
+ * resizing all at once and once resizing incrementally, so the
+ * tail latency of both modes can be compared.
+ *
+ * @param count The number of generated bids to insert
+ */
+void benchmarkRehash(unsigned int count) {
+    for (int incremental = 0; incremental < 2; incremental++) {
+        HashTable table;
+        table.SetIncrementalRehash(incremental == 1);
+
+        vector<long long> insertTimes;
+        vector<long long> searchTimes;
+        insertTimes.reserve(count);
+        searchTimes.reserve(count);
+
+        for (unsigned int i = 0; i < count; i++) {
+            Bid bid;
+            bid.bidId = to_string(i);
+
+            auto start = chrono::steady_clock::now();
+            table.Insert(bid);
+            auto end = chrono::steady_clock::now();
+            insertTimes.push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+
+            // look up an earlier bid so searches run during every resize too
+            string searchId = to_string((i * 7919ULL) % (i + 1));
+            start = chrono::steady_clock::now();
+            table.Find(searchId);
+            end = chrono::steady_clock::now();
+            searchTimes.push_back(chrono::duration_cast<chrono::nanoseconds>(end - start).count());
+        }
+
+        cout << (incremental == 1 ? "Incremental" : "Stop-the-world") << " resize, "
+                << count << " bids, " << table.Capacity() << " buckets" << endl;
+        printLatencies("Insert", insertTimes);
+        printLatencies("Search", searchTimes);
+    }
+}
+
+/**
+ * Compare the chaining, flat and perfect hash engines on lookups that
+ * mostly hit and lookups that mostly miss
+ *
+ * @param count The number of generated bids to load
+ */
+void benchmarkEngines(unsigned int count) {
+    HashTable chained;
+    FlatHashTable flat;
+    PerfectHashTable perfect;
+    HashTable* tables[] = { &chained, &flat, &perfect };
+    string names[] = { "Chaining", "Flat", "Perfect" };
+
+    for (int t = 0; t < 3; t++) {
+        auto start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; i++) {
+            Bid bid;
+            bid.bidId = to_string(i);
+            tables[t]->Insert(bid);
+        }
+        // count building the perfect hash as part of loading
+        tables[t]->Size();
+        auto end = chrono::steady_clock::now();
+        double insertNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        // hit-heavy: ids that were loaded, in a scattered order
+        unsigned int found = 0;
+        start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; i++) {
+            if (tables[t]->Find(to_string((i * 7919ULL) % count)) != nullptr) {
+                found++;
+            }
+        }
+        end = chrono::steady_clock::now();
+        double hitNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        // miss-heavy: ids past the end of the loaded range
+        start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; i++) {
+            if (tables[t]->Find(to_string(count + i)) != nullptr) {
+                found++;
+            }
+        }
+        end = chrono::steady_clock::now();
+        double missNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        // the same scattered hits copied out one at a time, then found
+        // in place one at a time and as one batch
+        vector<string> bidIds;
+        for (unsigned int i = 0; i < count; i++) {
+            bidIds.push_back(to_string((i * 7919ULL) % count));
+        }
+        vector<Bid> results(count);
+        start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; i++) {
+            results[i] = tables[t]->Search(bidIds[i]);
+        }
+        end = chrono::steady_clock::now();
+        double singleNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        unsigned int foundInPlace = 0;
+        start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; i++) {
+            foundInPlace += tables[t]->Find(bidIds[i]) != nullptr;
+        }
+        end = chrono::steady_clock::now();
+        double findNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        vector<const Bid*> batch;
+        start = chrono::steady_clock::now();
+        tables[t]->SearchBatch(bidIds, batch);
+        end = chrono::steady_clock::now();
+        double batchNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        cout << names[t] << ": insert " << insertNs << " ns | hit " << hitNs
+                << " ns | miss " << missNs << " ns | " << found << " found" << endl;
+        cout << names[t] << ": single search " << singleNs << " ns | single find " << findNs << " ns ("
+                << foundInPlace << " found) | batch find " << batchNs << " ns" << endl;
+    }
+}
+
+/**
+ * Time loading and searching a typed table, the same way
+ * benchmarkEngines times the virtual engines
+ *
+ * @param table The empty table to fill
+ * @param name Label for the output
+ * @param count The number of generated bids to load
+ */
+template <class Table>
+void benchmarkTypedTable(Table& table, string name, unsigned int count) {
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        Bid bid;
+        bid.bidId = to_string(i);
+        table.Insert(bid.bidId, bid);
+    }
+    auto end = chrono::steady_clock::now();
+    double insertNs = chrono::duration<double, nano>(end - start).count() / count;
+
+    unsigned int found = 0;
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        if (table.Search(to_string((i * 7919ULL) % count)) != nullptr) {
+            found++;
+        }
+    }
+    end = chrono::steady_clock::now();
+    double hitNs = chrono::duration<double, nano>(end - start).count() / count;
+
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        if (table.Search(to_string(count + i)) != nullptr) {
+            found++;
+        }
+    }
+    end = chrono::steady_clock::now();
+    double missNs = chrono::duration<double, nano>(end - start).count() / count;
+
+    cout << name << ": insert " << insertNs << " ns | hit " << hitNs
+            << " ns | miss " << missNs << " ns | " << found << " found" << endl;
+}
+
+/**
+ * Compare the ways of reducing a hash to a slot, then the typed table
+ * at a runtime size, a fixed prime size and a fixed power of two size
+ * against the virtual chaining table
+ *
+ * @param count The number of generated bids to load
+ */
+void benchmarkTypedTables(unsigned int count) {
+    const unsigned int reductions = 50000000;
+    const unsigned int PRIME_SLOTS = 300007;
+    const unsigned int POWER_SLOTS = 262144;
+
+    // volatile so the compiler cannot treat the divisor as a constant
+    volatile unsigned int runtimeDivisor = PRIME_SLOTS;
+    uint32_t divisor = runtimeDivisor;
+    FastModulo modulo;
+    modulo.SetDivisor(divisor);
+
+    string names[] = { "Runtime %", "Fastmod", "Constant %", "Mask" };
+    for (int method = 0; method < 4; method++) {
+        uint32_t state = 0x9e3779b9, sum = 0;
+        auto start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < reductions; i++) {
+            state = state * 1664525 + 1013904223;
+            switch (method) {
+            case 0: sum += state % divisor; break;
+            case 1: sum += modulo.Reduce(state); break;
+            case 2: sum += state % PRIME_SLOTS; break;
+            default: sum += state & (POWER_SLOTS - 1); break;
+            }
+        }
+        auto end = chrono::steady_clock::now();
+        cout << names[method] << ": " << chrono::duration<double, nano>(end - start).count() / reductions
+                << " ns per reduction (checksum " << sum << ")" << endl;
+    }
+
+    // the virtual chaining table, sized the same as the typed ones
+    HashTable chained(PRIME_SLOTS);
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        Bid bid;
+        bid.bidId = to_string(i);
+        chained.Insert(bid);
+    }
+    auto end = chrono::steady_clock::now();
+    double insertNs = chrono::duration<double, nano>(end - start).count() / count;
+    unsigned int found = 0;
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        if (chained.Find(to_string((i * 7919ULL) % count)) != nullptr) {
+            found++;
+        }
+    }
+    end = chrono::steady_clock::now();
+    double hitNs = chrono::duration<double, nano>(end - start).count() / count;
+    cout << "Virtual chaining: insert " << insertNs << " ns | hit " << hitNs << " ns | " << found << " found" << endl;
+
+    BasicHashTable<string, Bid> runtimeTable(PRIME_SLOTS);
+    benchmarkTypedTable(runtimeTable, "Typed runtime size", count);
+    BasicHashTable<string, Bid, WyHasher, PRIME_SLOTS>* primeTable = new BasicHashTable<string, Bid, WyHasher, PRIME_SLOTS>();
+    benchmarkTypedTable(*primeTable, "Typed fixed prime", count);
+    delete primeTable;
+    BasicHashTable<string, Bid, WyHasher, POWER_SLOTS>* powerTable = new BasicHashTable<string, Bid, WyHasher, POWER_SLOTS>();
+    benchmarkTypedTable(*powerTable, "Typed fixed power of two", count);
+    delete powerTable;
+}
+
+/**
+ * Measure throughput of the concurrent table from 1 to 64 threads
+ * with different shares of searches to inserts and removes
+ *
+ * @param count The number of generated bids to preload
+ */
+void benchmarkConcurrent(unsigned int count) {
+    const unsigned int opsPerThread = 200000;
+    int readPercents[] = { 100, 95, 50 };
+
+    for (int readPercent : readPercents) {
+        for (unsigned int threads = 1; threads <= 64; threads *= 2) {
+            ConcurrentHashTable table;
+            for (unsigned int i = 0; i < count; i++) {
+                Bid bid;
+                bid.bidId = to_string(i);
+                table.Insert(bid);
+            }
+
+            auto start = chrono::steady_clock::now();
+            vector<thread> workers;
+            for (unsigned int t = 0; t < threads; t++) {
+                workers.push_back(thread([&table, t, count, readPercent, opsPerThread]() {
+                    // cheap per thread random numbers, no shared state
+                    uint64_t state = 0x9e3779b97f4a7c15ULL * (t + 1);
+                    for (unsigned int i = 0; i < opsPerThread; i++) {
+                        state ^= state << 13;
+                        state ^= state >> 7;
+                        state ^= state << 17;
+                        string bidId = to_string(state % count);
+                        if ((int) (state >> 40) % 100 < readPercent) {
+                            table.Search(bidId);
+                        }
+                        else if (i % 2 == 0) {
+                            Bid bid;
+                            bid.bidId = bidId;
+                            table.Insert(bid);
+                        }
+                        else {
+                            table.Remove(bidId);
+                        }
+                    }
+                }));
+            }
+            for (thread& worker : workers) {
+                worker.join();
+            }
+            auto end = chrono::steady_clock::now();
+
+            double seconds = chrono::duration<double>(end - start).count();
+            cout << readPercent << "% reads, " << threads << " threads: "
+                    << threads * opsPerThread / seconds / 1e6 << " million ops/s" << endl;
+        }
+    }
+}
+
+/**
+ * Compare search throughput of the sharded and lock-free tables as
+ * reader threads are added, with one writer inserting and removing
+ * the whole time (about 95% reads at one reader per core)
+ *
+ * @param count The number of generated bids to preload
+ */
+void benchmarkReaders(unsigned int count) {
+    const unsigned int opsPerThread = 200000;
+
+    for (int engine = 0; engine < 2; engine++) {
+        for (unsigned int threads = 1; threads <= 64; threads *= 2) {
+            HashTable* table;
+            if (engine == 0) {
+                table = new ConcurrentHashTable();
+            } else {
+                table = new LockFreeHashTable();
+            }
+            for (unsigned int i = 0; i < count; i++) {
+                Bid bid;
+                bid.bidId = to_string(i);
+                table->Insert(bid);
+            }
+
+            // the writer churns bids past the preloaded range
+            atomic<bool> stop{ false };
+            thread writer([table, count, &stop]() {
+                for (unsigned int i = 0; !stop.load(); i = (i + 1) % 1024) {
+                    Bid bid;
+                    bid.bidId = to_string(count + i);
+                    table->Insert(bid);
+                    table->Remove(bid.bidId);
+                }
+            });
+
+            auto start = chrono::steady_clock::now();
+            vector<thread> readers;
+            for (unsigned int t = 0; t < threads; t++) {
+                readers.push_back(thread([table, t, count, opsPerThread]() {
+                    uint64_t state = 0x9e3779b97f4a7c15ULL * (t + 1);
+                    for (unsigned int i = 0; i < opsPerThread; i++) {
+                        state ^= state << 13;
+                        state ^= state >> 7;
+                        state ^= state << 17;
+                        table->Search(to_string(state % count));
+                    }
+                }));
+            }
+            for (thread& reader : readers) {
+                reader.join();
+            }
+            auto end = chrono::steady_clock::now();
+            stop.store(true);
+            writer.join();
+
+            double seconds = chrono::duration<double>(end - start).count();
+            cout << (engine == 0 ? "Sharded" : "Lock-free") << ", " << threads << " readers: "
+                    << threads * opsPerThread / seconds / 1e6 << " million searches/s" << endl;
+            delete table;
+        }
+    }
+}
+
 /**
  * Simple C function to convert a string to a double
  * after stripping out unwanted char
@@ -319,8 +4011,13 @@ double strToDouble(string str, char ch) {
 int main(int argc, char* argv[]) {
 
     // process command line arguments
-    string csvPath, bidKey;
+    string csvPath, bidKey, engine;
     switch (argc) {
+    case 4:
+        csvPath = argv[1];
+        bidKey = argv[2];
+        engine = argv[3];
+        break;
     case 2:
         csvPath = argv[1];
         bidKey = "98190";
@@ -341,7 +4038,37 @@ int main(int argc, char* argv[]) {
     HashTable* bidTable;
 
     Bid bid;
-    bidTable = new HashTable();
+    const Bid* found;
+
+    // set for the mapped engine, whose bids come only from its index file
+    bool readOnly = false;
+
+    // "flat" selects the open addressing engine, "concurrent" the
+    // sharded thread safe one, "lockfree" the lock-free reader one,
+    // "perfect" the read-only perfect hash, "mapped" an index file,
+    // chaining otherwise
+    if (engine == "flat") {
+        bidTable = new FlatHashTable();
+    } else if (engine == "concurrent") {
+        bidTable = new ConcurrentHashTable();
+    } else if (engine == "lockfree") {
+        bidTable = new LockFreeHashTable();
+    } else if (engine == "perfect") {
+        bidTable = new PerfectHashTable();
+    } else if (engine == "mapped") {
+        // the first argument is an index file written by option 10
+        MappedHashTable* mappedTable = new MappedHashTable();
+        ticks = clock();
+        if (!mappedTable->Open(csvPath)) {
+            cout << "Could not open index file " << csvPath << endl;
+        }
+        ticks = clock() - ticks;
+        cout << mappedTable->Size() << " bids mapped in " << ticks * 1.0 / CLOCKS_PER_SEC << " seconds" << endl;
+        bidTable = mappedTable;
+        readOnly = true;
+    } else {
+        bidTable = new HashTable();
+    }
     
     int choice = 0;
     while (choice != 9) {
@@ -350,6 +4077,14 @@ int main(int argc, char* argv[]) {
         cout << "  2. Display All Bids" << endl;
         cout << "  3. Find Bid" << endl;
         cout << "  4. Remove Bid" << endl;
+        cout << "  5. Benchmark Resize Latency" << endl;
+        cout << "  6. Benchmark Engines" << endl;
+        cout << "  7. Benchmark Concurrent Throughput" << endl;
+        cout << "  8. Benchmark Reader Scaling" << endl;
+        cout << "  10. Save Index File" << endl;
+        cout << "  11. Display Table Statistics" << endl;
+        cout << "  12. Benchmark Typed Tables" << endl;
+        cout << "  13. Find Bids by Fund" << endl;
         cout << "  9. Exit" << endl;
         cout << "Enter choice: ";
         cin >> choice;
@@ -357,13 +4092,20 @@ int main(int argc, char* argv[]) {
         switch (choice) {
 
         case 1:
-            
+            // the path names the index file, not a CSV
+            if (readOnly) {
+                cout << "The index file is read-only, load the CSV with another engine and save a new index." << endl;
+                break;
+            }
+
             // Initialize a timer variable before loading bids
             ticks = clock();
 
             // Complete the method call to load the bids
             loadBids(csvPath, bidTable);
 
+            cout << bidTable->Size() << " bids read into " << bidTable->Capacity() << " buckets" << endl;
+
             // Calculate elapsed time and display result
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
             cout << "time: " << ticks << " clock ticks" << endl;
@@ -377,12 +4119,12 @@ int main(int argc, char* argv[]) {
         case 3:
             ticks = clock();
 
-            bid = bidTable->Search(bidKey);
+            found = bidTable->Find(bidKey);
 
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
 
-            if (!bid.bidId.empty()) {
-                displayBid(bid);
+            if (found != nullptr) {
+                displayBid(*found);
             } else {
                 cout << "Bid Id " << bidKey << " not found." << endl;
             }
@@ -392,8 +4134,49 @@ int main(int argc, char* argv[]) {
             break;
 
         case 4:
+            if (readOnly) {
+                cout << "The index file is read-only, remove the bid from the CSV and save a new index." << endl;
+                break;
+            }
             bidTable->Remove(bidKey);
             break;
+
+        case 5:
+            benchmarkRehash(1000000);
+            break;
+
+        case 6:
+            benchmarkEngines(1000000);
+            break;
+
+        case 7:
+            benchmarkConcurrent(1000000);
+            break;
+
+        case 8:
+            benchmarkReaders(1000000);
+            break;
+
+        case 10:
+            // written next to the CSV, open it later with the "mapped" engine
+            if (bidTable->WriteIndex(csvPath + ".idx")) {
+                cout << "Index written to " << csvPath << ".idx" << endl;
+            } else {
+                cout << "Could not write " << csvPath << ".idx" << endl;
+            }
+            break;
+
+        case 11:
+            displayStats(bidTable->GetStats());
+            break;
+
+        case 12:
+            benchmarkTypedTables(200000);
+            break;
+
+        case 13:
+            listFundBids(bidTable);
+            break;
         }
     }
 
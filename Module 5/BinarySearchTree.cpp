@@ -6,19 +6,61 @@
 // Description : Binary Search Tree Data Structure
 //============================================================================
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <time.h>
 
 #include "CSVparser.hpp"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BINARYSEARCHTREE_SSE2 1
+#define PREFETCH(address) _mm_prefetch((const char*) (address), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address)
+#endif
+
 using namespace std;
 
 //============================================================================
 // Global definitions visible to all methods and classes
 //============================================================================
 
+// lookups walked down the tree side by side by SearchBatch
+const unsigned int BATCH_GROUP = 16;
+
+// keys per B+ tree node, their integer prefixes fill 16 cache lines and
+// a leaf of bids spans a few pages
+const unsigned int BTREE_ORDER = 128;
+
+// most levels in the concurrent skip list, enough for 4^24 bids
+const unsigned int SKIP_MAX_LEVELS = 24;
+
+// one node in this many reaches each next skip list level
+const unsigned int SKIP_BRANCHING = 4;
+
+// most threads that can read a lock-free structure at the same time
+const unsigned int MAX_READERS = 256;
+
+// removed nodes collected before the skip list tries to free them
+const unsigned int RECLAIM_BATCH = 64;
+
 // forward declarations
 double strToDouble(string str, char ch);
+uint64_t prefixOf(string_view key);
 
 // define a structure to hold bid information
 struct Bid {
@@ -31,23 +73,58 @@ struct Bid {
     }
 };
 
-// Internal structure for tree node
+// no child, slot 0 of a tree's arena stands in for every empty subtree
+const uint32_t NIL = 0;
+
+// Internal structure for tree node. Nodes sit side by side in their
+// tree's arena and link to each other by index, the bid is kept out of
+// line at the same index. The first 8 bytes of the id are copied into
+// the node, so most comparisons never touch the bid.
 struct Node {
-    Bid bid;
-    Node *left;
-    Node *right;
+    uint64_t prefix; // first 8 bytes of the bid id, see prefixOf
+    uint32_t left;
+    uint32_t right;
+    uint32_t size; // bids in this subtree
+    int32_t height; // levels in this subtree, only kept up to date when balanced
 
     // default constructor
     Node() {
-        left = nullptr;
-        right = nullptr;
+        prefix = 0;
+        left = NIL;
+        right = NIL;
+        height = 1;
+        size = 1;
     }
+};
 
-    // initialize with a bid
-    Node(Bid aBid) :
-            Node() {
-        bid = aBid;
-    }
+//============================================================================
+// Bid Cursor class definition
+//============================================================================
+
+class BinarySearchTree;
+struct BPlusLeaf;
+
+/**
+ * Position in the bids of a tree, in order of bid id. A binary tree
+ * cursor keeps the ancestors still to be visited on an explicit stack,
+ * a B+ tree cursor keeps its leaf and the index in it. Positioning costs
+ * O(log n) and each step O(1) amortized, so a range of k bids costs
+ * O(log n + k). Changing the tree invalidates its cursors.
+ */
+class BidCursor {
+    friend class BinarySearchTree;
+    friend class BPlusTree;
+
+private:
+    BinarySearchTree* tree = nullptr; // owner of the nodes on the stack
+    vector<uint32_t> stack; // top is the current node
+    BPlusLeaf* leaf = nullptr;
+    unsigned int index = 0;
+
+public:
+    bool Valid();
+    const Bid& Current();
+    void Next();
 };
 
 //============================================================================
@@ -59,192 +136,2979 @@ struct Node {
  * implement a binary search tree
  */
 class BinarySearchTree {
+    friend class BidCursor;
 
 private:
-    Node* root;
+    vector<Node> nodes; // the arena, slot NIL has size and height 0
+    vector<Bid> nodeBids; // bid of each node, at the node's index
+    uint32_t freeList; // removed slots, chained through left
+    uint32_t root;
+    bool balanced;
 
-    void inOrder(Node* node);
-    Node* removeNode(Node* node, string bidId);
+    uint32_t allocate(Bid bid);
+    void release(uint32_t node);
+    int compareKey(uint32_t node, string_view key, uint64_t prefix);
+    void inOrder(uint32_t node, void (*visit)(const Bid& bid));
+    void retrace(vector<uint32_t>& path);
+    void replaceChild(uint32_t parent, uint32_t child, uint32_t replacement);
+    void freeNodes();
+    uint32_t build(vector<Bid>& bids, size_t low, size_t high);
+    static void printBid(const Bid& bid);
+    int height(uint32_t node);
+    unsigned int size(uint32_t node);
+    void updateNode(uint32_t node);
+    uint32_t rotateLeft(uint32_t node);
+    uint32_t rotateRight(uint32_t node);
+    uint32_t rebalance(uint32_t node);
 
 public:
-    BinarySearchTree();
+    BinarySearchTree(bool balanced = false);
     virtual ~BinarySearchTree();
-    void InOrder();
-    void Insert(Bid bid);
-    void Remove(string bidId);
-    Bid Search(string bidId);
+    virtual void InOrder();
+    virtual void InOrder(void (*visit)(const Bid& bid));
+    virtual void Insert(Bid bid);
+    virtual void BulkLoad(vector<Bid> bids);
+    virtual void Remove(string bidId);
+    virtual const Bid* Find(string_view bidId);
+    virtual Bid Search(string bidId);
+    virtual void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    virtual int Height();
+    virtual BidCursor LowerBound(string bidId);
+    virtual BidCursor UpperBound(string bidId);
+    virtual BidCursor At(unsigned int position);
+    virtual unsigned int Size();
+    vector<Bid> Range(string lowId, string highId);
+    vector<Bid> Page(string afterId, unsigned int pageSize);
+    vector<Bid> PageAt(unsigned int pageNumber, unsigned int pageSize);
+    Bid Select(unsigned int position);
+    unsigned int Rank(string bidId);
+    unsigned int CountRange(string lowId, string highId);
+
+protected:
+    virtual unsigned int countBelow(string bidId, bool inclusive);
 };
 
 /**
- * Default constructor
+ * Pack the first 8 bytes of a key into an integer that orders the same
+ * way the strings do, shorter keys are padded with zeros
+ */
+uint64_t prefixOf(string_view key) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        prefix = (prefix << 8) | (i < key.size() ? (unsigned char) key[i] : 0);
+    }
+    return prefix;
+}
+
+/**
+ * Default constructor
+ *
+ * @param balanced Keep the tree AVL balanced so its height stays
+ *                 O(log n) even when the bids arrive in sorted order
+ */
+BinarySearchTree::BinarySearchTree(bool balanced) {
+    // FixMe (1): initialize housekeeping variables
+    // slot NIL is the empty subtree every missing child points at
+    nodes.resize(1);
+    nodes[NIL].size = 0;
+    nodes[NIL].height = 0;
+    nodeBids.resize(1);
+    freeList = NIL;
+    //root is equal to NIL
+    root = NIL;
+    this->balanced = balanced;
+}
+
+/**
+ * Destructor, the arena goes in one piece
+ */
+BinarySearchTree::~BinarySearchTree() {
+}
+
+/**
+ * Empty the tree. Nodes hold no pointers, so the arena is cut back to
+ * slot NIL at once instead of visiting every node, and keeps its
+ * capacity for the next load.
+ */
+void BinarySearchTree::freeNodes() {
+    nodes.resize(1);
+    nodeBids.resize(1);
+    freeList = NIL;
+    root = NIL;
+}
+
+/**
+ * Take a slot for a new leaf, reusing a removed node's if there is one
+ *
+ * @param bid The bid the node holds
+ * @return Index of the node
+ */
+uint32_t BinarySearchTree::allocate(Bid bid) {
+    uint32_t node = freeList;
+    if (node != NIL) {
+        freeList = nodes[node].left;
+        nodes[node] = Node();
+        nodeBids[node] = std::move(bid);
+    } else {
+        node = (uint32_t) nodes.size();
+        nodes.push_back(Node());
+        nodeBids.push_back(std::move(bid));
+    }
+    nodes[node].prefix = prefixOf(nodeBids[node].bidId);
+    return node;
+}
+
+/**
+ * Give an unlinked node's slot back for reuse
+ */
+void BinarySearchTree::release(uint32_t node) {
+    nodeBids[node] = Bid();
+    nodes[node].left = freeList;
+    freeList = node;
+}
+
+/**
+ * Compare a node's id with a key, reading the bid only when the first
+ * 8 bytes tie
+ *
+ * @param prefix prefixOf(key)
+ * @return Less than, equal to or greater than 0 as the node's id is
+ *         less than, equal to or greater than key
+ */
+int BinarySearchTree::compareKey(uint32_t node, string_view key, uint64_t prefix) {
+    if (nodes[node].prefix != prefix) {
+        return nodes[node].prefix < prefix ? -1 : 1;
+    }
+    return nodeBids[node].bidId.compare(key);
+}
+
+void BinarySearchTree::InOrder() {
+    this->inOrder(root, printBid);
+}
+
+/**
+ * Pass every bid to a function in order
+ */
+void BinarySearchTree::InOrder(void (*visit)(const Bid& bid)) {
+    this->inOrder(root, visit);
+}
+
+/**
+ * Returns the height of a subtree, 0 for an empty one
+ */
+int BinarySearchTree::height(uint32_t node) {
+    return nodes[node].height;
+}
+
+/**
+ * Returns the number of bids in a subtree, 0 for an empty one
+ */
+unsigned int BinarySearchTree::size(uint32_t node) {
+    return nodes[node].size;
+}
+
+/**
+ * Recompute a node's height and subtree size from its children
+ */
+void BinarySearchTree::updateNode(uint32_t node) {
+    Node& current = nodes[node];
+    current.height = 1 + max(height(current.left), height(current.right));
+    current.size = 1 + size(current.left) + size(current.right);
+}
+
+/**
+ * Rotate a subtree left, its right child becomes the new top
+ *
+ * @param node Top of the subtree
+ * @return The new top of the subtree
+ */
+uint32_t BinarySearchTree::rotateLeft(uint32_t node) {
+    uint32_t top = nodes[node].right;
+    nodes[node].right = nodes[top].left;
+    nodes[top].left = node;
+    updateNode(node);
+    updateNode(top);
+    return top;
+}
+
+/**
+ * Rotate a subtree right, its left child becomes the new top
+ *
+ * @param node Top of the subtree
+ * @return The new top of the subtree
+ */
+uint32_t BinarySearchTree::rotateRight(uint32_t node) {
+    uint32_t top = nodes[node].left;
+    nodes[node].left = nodes[top].right;
+    nodes[top].right = node;
+    updateNode(node);
+    updateNode(top);
+    return top;
+}
+
+/**
+ * Restore the AVL property at a node whose children are balanced but
+ * may differ in height by two after an insert or remove below it
+ *
+ * @param node Top of the subtree, may be null
+ * @return The new top of the subtree
+ */
+uint32_t BinarySearchTree::rebalance(uint32_t node) {
+    if (node == NIL) {
+        return node;
+    }
+    updateNode(node);
+    Node& current = nodes[node];
+    int balance = height(current.left) - height(current.right);
+
+    // left heavy, a left-right shape needs its child turned first
+    if (balance > 1) {
+        if (height(nodes[current.left].left) < height(nodes[current.left].right)) {
+            current.left = rotateLeft(current.left);
+        }
+        return rotateRight(node);
+    }
+    // right heavy, mirror image
+    if (balance < -1) {
+        if (height(nodes[current.right].right) < height(nodes[current.right].left)) {
+            current.right = rotateRight(current.right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+/**
+ * Insert a bid
+ */
+void BinarySearchTree::Insert(Bid bid) {
+    // FIXME (5) Implement inserting a bid into the tree
+    uint32_t newNode = allocate(std::move(bid));
+    const string& bidId = nodeBids[newNode].bidId;
+    uint64_t prefix = nodes[newNode].prefix;
+
+    // the balanced tree retraces the path back up, fixing heights and
+    // rotating where one side grew two levels taller than the other
+    if (balanced) {
+        vector<uint32_t> path;
+        for (uint32_t currNode = root; currNode != NIL;) {
+            path.push_back(currNode);
+            currNode = compareKey(currNode, bidId, prefix) > 0 ? nodes[currNode].left : nodes[currNode].right;
+        }
+        if (path.empty()) {
+            root = newNode;
+            return;
+        }
+        if (compareKey(path.back(), bidId, prefix) > 0) {
+            nodes[path.back()].left = newNode;
+        } else {
+            nodes[path.back()].right = newNode;
+        }
+        retrace(path);
+        return;
+    }
+
+    // if root equarl to NIL
+    if (root == NIL) {
+        // root is equal to new node bid
+        root = newNode;
+    }
+    else {
+        // Create new node equal to root node
+        uint32_t currNode = root;
+
+        // Continue looping through tree until a proper spot has been found for the new node
+        while (currNode != NIL) {
+            Node& current = nodes[currNode];
+            // the new node ends up somewhere below this one
+            current.size++;
+            // LEFT branch
+            if (compareKey(currNode, bidId, prefix) > 0) {
+                // IF no left node set it to the new node
+                if (current.left == NIL) {
+                    current.left = newNode;
+                    currNode = NIL;
+                }
+                // Set currNode to the new left node
+                else {
+                    currNode = current.left;
+                }
+            }
+            // RIGHT branch
+            else {
+                // IF no right node set it to the new node
+                if (current.right == NIL) {
+                    current.right = newNode;
+                    currNode = NIL;
+                }
+                // Set currNode to the new right node
+                else {
+                    currNode = current.right;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Load many bids at once. Bids already sorted by id are detected and
+ * not sorted again, any bids already in the tree are merged in, and
+ * the tree is rebuilt perfectly balanced in O(n) instead of n inserts.
+ *
+ * @param bids The bids to add
+ */
+void BinarySearchTree::BulkLoad(vector<Bid> bids) {
+    auto byId = [](const Bid& a, const Bid& b) {
+        return a.bidId < b.bidId;
+    };
+    if (!is_sorted(bids.begin(), bids.end(), byId)) {
+        stable_sort(bids.begin(), bids.end(), byId);
+    }
+
+    // the tree's own bids come out in order, so merging keeps it linear
+    if (root != NIL) {
+        vector<Bid> current;
+        current.reserve(Size());
+        for (BidCursor cursor = BinarySearchTree::LowerBound(""); cursor.Valid(); cursor.Next()) {
+            current.push_back(cursor.Current());
+        }
+        vector<Bid> merged;
+        merged.reserve(current.size() + bids.size());
+        merge(current.begin(), current.end(), bids.begin(), bids.end(), back_inserter(merged), byId);
+        bids.swap(merged);
+    }
+
+    // start over with an arena exactly the size of the new tree
+    freeNodes();
+    nodes.reserve(bids.size() + 1);
+    nodeBids.reserve(bids.size() + 1);
+    root = build(bids, 0, bids.size());
+}
+
+/**
+ * Build a perfectly balanced subtree from sorted bids, the middle bid
+ * becomes the top. Recursion is only as deep as the balanced tree.
+ *
+ * @param bids Bids sorted by id, moved into the new nodes
+ * @param low First bid of the subtree
+ * @param high One past the last bid of the subtree
+ * @return Top of the subtree, NIL if it is empty
+ */
+uint32_t BinarySearchTree::build(vector<Bid>& bids, size_t low, size_t high) {
+    if (low >= high) {
+        return NIL;
+    }
+    // a parent lands in the arena just before its left subtree
+    size_t middle = low + (high - low) / 2;
+    uint32_t node = allocate(std::move(bids[middle]));
+    uint32_t left = build(bids, low, middle);
+    uint32_t right = build(bids, middle + 1, high);
+    nodes[node].left = left;
+    nodes[node].right = right;
+    updateNode(node);
+    return node;
+}
+
+/**
+ * Remove a bid
+ */
+void BinarySearchTree::Remove(string bidId) {
+    // FIXME (6) Implement removing a bid from the tree
+    // walk down to the bid, remembering the way back up
+    uint64_t prefix = prefixOf(bidId);
+    vector<uint32_t> path;
+    uint32_t node = root;
+    int order;
+    while (node != NIL && (order = compareKey(node, bidId, prefix)) != 0) {
+        path.push_back(node);
+        node = order > 0 ? nodes[node].left : nodes[node].right;
+    }
+    if (node == NIL) {
+        return;
+    }
+
+    // two children: take over the successor's bid and unlink the
+    // successor instead, it has no left child
+    if (nodes[node].left != NIL && nodes[node].right != NIL) {
+        path.push_back(node);
+        uint32_t successor = nodes[node].right;
+        while (nodes[successor].left != NIL) {
+            path.push_back(successor);
+            successor = nodes[successor].left;
+        }
+        nodeBids[node] = std::move(nodeBids[successor]);
+        nodes[node].prefix = nodes[successor].prefix;
+        node = successor;
+    }
+
+    // at most one child now, which takes the node's place
+    uint32_t child = nodes[node].left != NIL ? nodes[node].left : nodes[node].right;
+    replaceChild(path.empty() ? NIL : path.back(), node, child);
+    release(node);
+
+    // rotate on the way back up where a side lost a level, a plain
+    // tree just counts one bid fewer under each node passed
+    if (balanced) {
+        retrace(path);
+    } else {
+        for (uint32_t ancestor : path) {
+            nodes[ancestor].size--;
+        }
+    }
+}
+
+/**
+ * Point a parent, or the root if there is none, at a new child
+ *
+ * @param parent The node holding child, NIL if child is the root
+ * @param child The child being replaced
+ * @param replacement The node to put in its place, may be NIL
+ */
+void BinarySearchTree::replaceChild(uint32_t parent, uint32_t child, uint32_t replacement) {
+    if (parent == NIL) {
+        root = replacement;
+    } else if (nodes[parent].left == child) {
+        nodes[parent].left = replacement;
+    } else {
+        nodes[parent].right = replacement;
+    }
+}
+
+/**
+ * Rebalance every node on a path from the root, bottom up, after the
+ * subtree under its last node changed height
+ *
+ * @param path Nodes from the root down, each the parent of the next
+ */
+void BinarySearchTree::retrace(vector<uint32_t>& path) {
+    for (size_t i = path.size(); i-- > 0;) {
+        uint32_t top = rebalance(path[i]);
+        if (top != path[i]) {
+            replaceChild(i == 0 ? NIL : path[i - 1], path[i], top);
+        }
+    }
+}
+
+/**
+ * Find the bid with the specified bidId without copying it
+ *
+ * @param bidId The bid id to search for
+ * @return The bid in the tree, nullptr if not found. It stays valid
+ *         until the next insert or remove, which may move the arena.
+ */
+const Bid* BinarySearchTree::Find(string_view bidId) {
+    // FIXME (7) Implement searching the tree for a bid
+    // set current node equal to root
+    uint64_t prefix = prefixOf(bidId);
+    uint32_t currNode = root;
+
+    // keep looping downwards until bottom reached or matching bidId found
+    while (currNode != NIL) {
+        int order = compareKey(currNode, bidId, prefix);
+        // if match found, return current bid
+        if (order == 0) {
+            return &nodeBids[currNode];
+        }
+        // if bid is smaller than current node then traverse left
+        else if (order > 0) {
+            currNode = nodes[currNode].left;
+        }
+        // else larger so traverse right
+        else {
+            currNode = nodes[currNode].right;
+        }
+    }
+    // Bid not found
+    return nullptr;
+}
+
+/**
+ * Search for a bid
+ */
+Bid BinarySearchTree::Search(string bidId) {
+    const Bid* found = Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+    // Bid not found, return empty bid
+    Bid bid;
+    return bid;
+}
+
+/**
+ * Find many bids at once without copying them. A group of lookups walks
+ * down the tree together, one level per pass, and the next node of every
+ * lookup is prefetched while the others are compared, so their cache
+ * misses overlap instead of stalling one after another.
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until the next insert or remove.
+ */
+void BinarySearchTree::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    results.assign(bidIds.size(), nullptr);
+
+    uint32_t current[BATCH_GROUP];
+    uint64_t prefixes[BATCH_GROUP];
+    for (size_t start = 0; start < bidIds.size(); start += BATCH_GROUP) {
+        size_t end = min(bidIds.size(), start + BATCH_GROUP);
+        for (size_t i = start; i < end; i++) {
+            current[i - start] = root;
+            prefixes[i - start] = prefixOf(bidIds[i]);
+        }
+
+        // keep passing over the group until every lookup hit bottom or matched
+        bool active = true;
+        while (active) {
+            active = false;
+            for (size_t i = start; i < end; i++) {
+                uint32_t currNode = current[i - start];
+                if (currNode == NIL) {
+                    continue;
+                }
+
+                int order = compareKey(currNode, bidIds[i], prefixes[i - start]);
+                // if match found, this lookup is done
+                if (order == 0) {
+                    results[i] = &nodeBids[currNode];
+                    current[i - start] = NIL;
+                    continue;
+                }
+
+                // step down and start loading the child for the next pass
+                currNode = order > 0 ? nodes[currNode].left : nodes[currNode].right;
+                current[i - start] = currNode;
+                if (currNode != NIL) {
+                    PREFETCH(&nodes[currNode]);
+                    active = true;
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Returns the number of levels in the tree, counted without recursion
+ * since an unbalanced tree can be as deep as it has bids
+ */
+int BinarySearchTree::Height() {
+    int tallest = 0;
+    vector<pair<uint32_t, int>> pending;
+    if (root != NIL) {
+        pending.push_back(make_pair(root, 1));
+    }
+    while (!pending.empty()) {
+        uint32_t node = pending.back().first;
+        int depth = pending.back().second;
+        pending.pop_back();
+        tallest = max(tallest, depth);
+        if (nodes[node].left != NIL) {
+            pending.push_back(make_pair(nodes[node].left, depth + 1));
+        }
+        if (nodes[node].right != NIL) {
+            pending.push_back(make_pair(nodes[node].right, depth + 1));
+        }
+    }
+    return tallest;
+}
+
+/**
+ * Position a cursor at the first bid whose id is not less than bidId
+ *
+ * @param bidId The id to start from
+ * @return Cursor at that bid, not Valid if every id is smaller
+ */
+BidCursor BinarySearchTree::LowerBound(string bidId) {
+    // every node where the walk turns left is still ahead of the cursor
+    BidCursor cursor;
+    cursor.tree = this;
+    uint64_t prefix = prefixOf(bidId);
+    uint32_t node = root;
+    while (node != NIL) {
+        if (compareKey(node, bidId, prefix) < 0) {
+            node = nodes[node].right;
+        } else {
+            cursor.stack.push_back(node);
+            node = nodes[node].left;
+        }
+    }
+    return cursor;
+}
+
+/**
+ * Position a cursor at the first bid whose id is greater than bidId
+ *
+ * @param bidId The id to start after
+ * @return Cursor at that bid, not Valid if no id is greater
+ */
+BidCursor BinarySearchTree::UpperBound(string bidId) {
+    BidCursor cursor;
+    cursor.tree = this;
+    uint64_t prefix = prefixOf(bidId);
+    uint32_t node = root;
+    while (node != NIL) {
+        if (compareKey(node, bidId, prefix) <= 0) {
+            node = nodes[node].right;
+        } else {
+            cursor.stack.push_back(node);
+            node = nodes[node].left;
+        }
+    }
+    return cursor;
+}
+
+/**
+ * Collect the bids with ids from lowId to highId, both included
+ *
+ * @return The bids in order of id
+ */
+vector<Bid> BinarySearchTree::Range(string lowId, string highId) {
+    vector<Bid> bids;
+    for (BidCursor cursor = LowerBound(lowId); cursor.Valid() && cursor.Current().bidId <= highId; cursor.Next()) {
+        bids.push_back(cursor.Current());
+    }
+    return bids;
+}
+
+/**
+ * Collect one page of bids in order of id. Pass the id of the last bid
+ * of the previous page to get the next one, or an empty id for the first.
+ *
+ * @param afterId The last id already seen
+ * @param pageSize The most bids to return
+ * @return The page, shorter than pageSize on the last page
+ */
+vector<Bid> BinarySearchTree::Page(string afterId, unsigned int pageSize) {
+    vector<Bid> bids;
+    BidCursor cursor = afterId.empty() ? LowerBound(afterId) : UpperBound(afterId);
+    for (; cursor.Valid() && bids.size() < pageSize; cursor.Next()) {
+        bids.push_back(cursor.Current());
+    }
+    return bids;
+}
+
+/**
+ * Position a cursor at the bid with the given position in id order,
+ * found through the subtree sizes in O(log n)
+ *
+ * @param position 0 for the smallest id
+ * @return Cursor at that bid, not Valid if position is past the end
+ */
+BidCursor BinarySearchTree::At(unsigned int position) {
+    // as in LowerBound, nodes where the walk turns left are still ahead
+    BidCursor cursor;
+    cursor.tree = this;
+    uint32_t node = root;
+    while (node != NIL) {
+        unsigned int leftSize = size(nodes[node].left);
+        if (position < leftSize) {
+            cursor.stack.push_back(node);
+            node = nodes[node].left;
+        } else if (position == leftSize) {
+            cursor.stack.push_back(node);
+            break;
+        } else {
+            position -= leftSize + 1;
+            node = nodes[node].right;
+        }
+    }
+    return cursor;
+}
+
+/**
+ * Returns the number of bids in the tree
+ */
+unsigned int BinarySearchTree::Size() {
+    return size(root);
+}
+
+/**
+ * Count the bids with ids less than (or also equal to) bidId
+ *
+ * @param bidId The id to compare against
+ * @param inclusive Count ids equal to bidId too
+ */
+unsigned int BinarySearchTree::countBelow(string bidId, bool inclusive) {
+    uint64_t prefix = prefixOf(bidId);
+    unsigned int count = 0;
+    uint32_t node = root;
+    while (node != NIL) {
+        int order = compareKey(node, bidId, prefix);
+        if (order < 0 || (inclusive && order == 0)) {
+            // this node and everything left of it is below
+            count += size(nodes[node].left) + 1;
+            node = nodes[node].right;
+        } else {
+            node = nodes[node].left;
+        }
+    }
+    return count;
+}
+
+/**
+ * Collect a numbered page of bids in order of id, page 37 costs the
+ * same as page 0
+ *
+ * @param pageNumber Page to return, 0 for the first
+ * @param pageSize Bids per page
+ * @return The page, shorter than pageSize on the last page
+ */
+vector<Bid> BinarySearchTree::PageAt(unsigned int pageNumber, unsigned int pageSize) {
+    vector<Bid> bids;
+    BidCursor cursor = At(pageNumber * pageSize);
+    for (; cursor.Valid() && bids.size() < pageSize; cursor.Next()) {
+        bids.push_back(cursor.Current());
+    }
+    return bids;
+}
+
+/**
+ * Returns the bid at a position in id order, empty past the end
+ *
+ * @param position 0 for the smallest id
+ */
+Bid BinarySearchTree::Select(unsigned int position) {
+    BidCursor cursor = At(position);
+    if (cursor.Valid()) {
+        return cursor.Current();
+    }
+    Bid bid;
+    return bid;
+}
+
+/**
+ * Returns the number of bids with ids less than bidId, which is also
+ * the position bidId has or would have in id order
+ */
+unsigned int BinarySearchTree::Rank(string bidId) {
+    return countBelow(bidId, false);
+}
+
+/**
+ * Returns the number of bids with ids from lowId to highId, both included
+ */
+unsigned int BinarySearchTree::CountRange(string lowId, string highId) {
+    if (highId < lowId) {
+        return 0;
+    }
+    return countBelow(highId, true) - countBelow(lowId, false);
+}
+
+/**
+ * Output bidID, title, amount, fund
+ */
+void BinarySearchTree::printBid(const Bid& bid) {
+    cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | " << bid.fund << endl;
+}
+
+/**
+ * Visit a subtree in order with an explicit stack, so a tree as deep
+ * as it has bids cannot overflow the call stack
+ */
+void BinarySearchTree::inOrder(uint32_t node, void (*visit)(const Bid& bid)) {
+    vector<uint32_t> stack;
+    while (node != NIL || !stack.empty()) {
+        //InOrder left
+        while (node != NIL) {
+            stack.push_back(node);
+            node = nodes[node].left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        visit(nodeBids[node]);
+        //InOrder right
+        node = nodes[node].right;
+    }
+}
+
+//============================================================================
+// B+ Tree class definition
+//============================================================================
+
+// Internal structure for B+ tree nodes. Keys are kept sorted, and the
+// first 8 bytes of each key are also packed big-endian into an integer
+// so most comparisons are integer compares over one dense array. Only
+// inner nodes store their keys as strings, a leaf's keys are the ids of
+// its bids.
+struct BPlusNode {
+    bool leaf;
+    unsigned int count; // keys in use
+    uint64_t prefixes[BTREE_ORDER];
+
+    BPlusNode(bool isLeaf) {
+        leaf = isLeaf;
+        count = 0;
+    }
+};
+
+// inner node, keys[i] is the smallest key under children[i + 1] and
+// counts[i] the number of bids under children[i]
+struct BPlusInner : BPlusNode {
+    string keys[BTREE_ORDER];
+    BPlusNode* children[BTREE_ORDER + 1];
+    unsigned int counts[BTREE_ORDER + 1];
+
+    BPlusInner() :
+            BPlusNode(false) {
+    }
+};
+
+// leaf node, holds the bids and is linked to its neighbours for scans
+struct BPlusLeaf : BPlusNode {
+    Bid bids[BTREE_ORDER];
+    BPlusLeaf* prev;
+    BPlusLeaf* next;
+
+    BPlusLeaf() :
+            BPlusNode(true) {
+        prev = nullptr;
+        next = nullptr;
+    }
+};
+
+// inner nodes passed on the way down, with the child index taken in each
+typedef vector<pair<BPlusInner*, unsigned int>> BPlusPath;
+
+/**
+ * B+ tree holding up to BTREE_ORDER keys per node. A lookup touches
+ * about log32(n) nodes instead of log2(n), and scans follow the linked
+ * leaves. Bid ids are unique: inserting an id that is already present
+ * replaces its bid. Leaves are freed once they are empty rather than
+ * merged when half full, so a tree that shrinks keeps its height.
+ */
+class BPlusTree : public BinarySearchTree {
+
+private:
+    BPlusNode* root;
+    unsigned int size;
+
+    static unsigned int total(BPlusNode* node);
+    static const string& keyAt(BPlusNode* node, unsigned int pos);
+    static unsigned int lowerBound(BPlusNode* node, string_view key, uint64_t prefix);
+    static unsigned int childFor(BPlusInner* node, string_view key, uint64_t prefix);
+    static void insertInLeaf(BPlusLeaf* leaf, unsigned int pos, const Bid& bid, uint64_t prefix);
+    static void insertInInner(BPlusInner* inner, unsigned int pos, const string& key, BPlusNode* child,
+            unsigned int childCount);
+    static void removeFromInner(BPlusInner* inner, unsigned int child);
+    BPlusLeaf* findLeaf(string_view key, uint64_t prefix, BPlusPath* path);
+    BPlusLeaf* firstLeaf();
+    void insertSeparator(BPlusPath& path, string key, BPlusNode* right);
+    void freeNodes();
+
+protected:
+    unsigned int countBelow(string bidId, bool inclusive);
+
+public:
+    BPlusTree();
+    virtual ~BPlusTree();
+    void InOrder();
+    void InOrder(void (*visit)(const Bid& bid));
+    void Insert(Bid bid);
+    void BulkLoad(vector<Bid> bids);
+    void Remove(string bidId);
+    const Bid* Find(string_view bidId);
+    Bid Search(string bidId);
+    void SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results);
+    int Height();
+    unsigned int Size();
+    BidCursor LowerBound(string bidId);
+    BidCursor UpperBound(string bidId);
+    BidCursor At(unsigned int position);
+};
+
+/**
+ * Default constructor, an empty tree is a single empty leaf
+ */
+BPlusTree::BPlusTree() {
+    root = new BPlusLeaf();
+    size = 0;
+}
+
+/**
+ * Destructor, frees every node without recursion
+ */
+BPlusTree::~BPlusTree() {
+    freeNodes();
+}
+
+/**
+ * Free every node without recursion, root is left dangling
+ */
+void BPlusTree::freeNodes() {
+    vector<BPlusNode*> pending;
+    pending.push_back(root);
+    while (!pending.empty()) {
+        BPlusNode* node = pending.back();
+        pending.pop_back();
+        if (node->leaf) {
+            delete (BPlusLeaf*) node;
+        } else {
+            BPlusInner* inner = (BPlusInner*) node;
+            for (unsigned int i = 0; i <= inner->count; i++) {
+                pending.push_back(inner->children[i]);
+            }
+            delete inner;
+        }
+    }
+}
+
+/**
+ * Returns the number of bids under a node
+ */
+unsigned int BPlusTree::total(BPlusNode* node) {
+    if (node->leaf) {
+        return node->count;
+    }
+    BPlusInner* inner = (BPlusInner*) node;
+    unsigned int bids = 0;
+    for (unsigned int i = 0; i <= inner->count; i++) {
+        bids += inner->counts[i];
+    }
+    return bids;
+}
+
+/**
+ * Returns the key at pos, a separator in an inner node or a bid's id in a leaf
+ */
+const string& BPlusTree::keyAt(BPlusNode* node, unsigned int pos) {
+    return node->leaf ? ((BPlusLeaf*) node)->bids[pos].bidId : ((BPlusInner*) node)->keys[pos];
+}
+
+/**
+ * Find the first key in a node that is not less than the given key.
+ * The binary search over the prefixes has no branches to mispredict,
+ * and full strings are only compared when prefixes tie.
+ *
+ * @return Position of the first key >= key, count if there is none
+ */
+unsigned int BPlusTree::lowerBound(BPlusNode* node, string_view key, uint64_t prefix) {
+    if (node->count == 0) {
+        return 0;
+    }
+    // halve the range each step with a conditional move, not a branch
+    const uint64_t* base = node->prefixes;
+    for (unsigned int length = node->count; length > 1; length -= length / 2) {
+        base = base[length / 2] < prefix ? base + length / 2 : base;
+    }
+    unsigned int pos = (unsigned int) (base - node->prefixes) + (*base < prefix);
+    while (pos < node->count && node->prefixes[pos] == prefix && keyAt(node, pos) < key) {
+        pos++;
+    }
+    return pos;
+}
+
+/**
+ * Pick the child of an inner node whose range holds the key
+ */
+unsigned int BPlusTree::childFor(BPlusInner* node, string_view key, uint64_t prefix) {
+    unsigned int pos = lowerBound(node, key, prefix);
+    if (pos < node->count && node->prefixes[pos] == prefix && node->keys[pos] == key) {
+        pos++;
+    }
+    return pos;
+}
+
+/**
+ * Shift a leaf's entries right and place a bid at pos, the leaf has room
+ */
+void BPlusTree::insertInLeaf(BPlusLeaf* leaf, unsigned int pos, const Bid& bid, uint64_t prefix) {
+    for (unsigned int i = leaf->count; i > pos; i--) {
+        leaf->prefixes[i] = leaf->prefixes[i - 1];
+        leaf->bids[i] = std::move(leaf->bids[i - 1]);
+    }
+    leaf->prefixes[pos] = prefix;
+    leaf->bids[pos] = bid;
+    leaf->count++;
+}
+
+/**
+ * Place a key at pos and the child to its right at pos + 1, the node has room
+ */
+void BPlusTree::insertInInner(BPlusInner* inner, unsigned int pos, const string& key, BPlusNode* child,
+        unsigned int childCount) {
+    for (unsigned int i = inner->count; i > pos; i--) {
+        inner->prefixes[i] = inner->prefixes[i - 1];
+        inner->keys[i] = std::move(inner->keys[i - 1]);
+        inner->children[i + 1] = inner->children[i];
+        inner->counts[i + 1] = inner->counts[i];
+    }
+    inner->prefixes[pos] = prefixOf(key);
+    inner->keys[pos] = key;
+    inner->children[pos + 1] = child;
+    inner->counts[pos + 1] = childCount;
+    inner->count++;
+}
+
+/**
+ * Drop a child and the key beside it, its range goes to a neighbour
+ */
+void BPlusTree::removeFromInner(BPlusInner* inner, unsigned int child) {
+    for (unsigned int i = child > 0 ? child - 1 : 0; i + 1 < inner->count; i++) {
+        inner->prefixes[i] = inner->prefixes[i + 1];
+        inner->keys[i] = std::move(inner->keys[i + 1]);
+    }
+    for (unsigned int i = child; i < inner->count; i++) {
+        inner->children[i] = inner->children[i + 1];
+        inner->counts[i] = inner->counts[i + 1];
+    }
+    inner->count--;
+}
+
+/**
+ * Walk down to the leaf whose range holds the key
+ *
+ * @param path If not null, filled with the inner nodes passed
+ */
+BPlusLeaf* BPlusTree::findLeaf(string_view key, uint64_t prefix, BPlusPath* path) {
+    BPlusNode* node = root;
+    while (!node->leaf) {
+        BPlusInner* inner = (BPlusInner*) node;
+        unsigned int child = childFor(inner, key, prefix);
+        if (path != nullptr) {
+            path->push_back(make_pair(inner, child));
+        }
+        node = inner->children[child];
+    }
+    return (BPlusLeaf*) node;
+}
+
+/**
+ * Returns the leaf holding the smallest keys
+ */
+BPlusLeaf* BPlusTree::firstLeaf() {
+    BPlusNode* node = root;
+    while (!node->leaf) {
+        node = ((BPlusInner*) node)->children[0];
+    }
+    return (BPlusLeaf*) node;
+}
+
+/**
+ * Add the separator for a newly split node to its parent, splitting
+ * full parents in turn and growing a new root if the old one split
+ *
+ * @param path Inner nodes passed on the way down to the split node
+ * @param key Smallest key under the new node
+ * @param right The new node, to the right of the one that split
+ */
+void BPlusTree::insertSeparator(BPlusPath& path, string key, BPlusNode* right) {
+    while (!path.empty()) {
+        BPlusInner* parent = path.back().first;
+        unsigned int pos = path.back().second;
+        path.pop_back();
+        // the count for the node that split still covers both halves
+        if (parent->count < BTREE_ORDER) {
+            insertInInner(parent, pos, key, right, total(right));
+            parent->counts[pos] -= parent->counts[pos + 1];
+            return;
+        }
+
+        // full, line up all the keys and children and split them around
+        // the middle key, which moves up a level
+        vector<string> keys(parent->keys, parent->keys + BTREE_ORDER);
+        vector<BPlusNode*> children(parent->children, parent->children + BTREE_ORDER + 1);
+        vector<unsigned int> counts(parent->counts, parent->counts + BTREE_ORDER + 1);
+        keys.insert(keys.begin() + pos, key);
+        children.insert(children.begin() + pos + 1, right);
+        counts.insert(counts.begin() + pos + 1, total(right));
+        counts[pos] -= counts[pos + 1];
+
+        unsigned int middle = (BTREE_ORDER + 1) / 2;
+        BPlusInner* sibling = new BPlusInner();
+        parent->count = middle;
+        for (unsigned int i = 0; i < middle; i++) {
+            parent->keys[i] = keys[i];
+            parent->prefixes[i] = prefixOf(keys[i]);
+            parent->children[i] = children[i];
+            parent->counts[i] = counts[i];
+        }
+        parent->children[middle] = children[middle];
+        parent->counts[middle] = counts[middle];
+        sibling->count = BTREE_ORDER - middle;
+        for (unsigned int i = 0; i < sibling->count; i++) {
+            sibling->keys[i] = keys[middle + 1 + i];
+            sibling->prefixes[i] = prefixOf(sibling->keys[i]);
+            sibling->children[i] = children[middle + 1 + i];
+            sibling->counts[i] = counts[middle + 1 + i];
+        }
+        sibling->children[sibling->count] = children[BTREE_ORDER + 1];
+        sibling->counts[sibling->count] = counts[BTREE_ORDER + 1];
+
+        key = keys[middle];
+        right = sibling;
+    }
+
+    // the root split, the tree grows a level
+    BPlusInner* top = new BPlusInner();
+    top->keys[0] = key;
+    top->prefixes[0] = prefixOf(key);
+    top->children[0] = root;
+    top->children[1] = right;
+    top->counts[0] = total(root);
+    top->counts[1] = total(right);
+    top->count = 1;
+    root = top;
+}
+
+/**
+ * Insert a bid, replacing the bid with the same id if there is one
+ */
+void BPlusTree::Insert(Bid bid) {
+    uint64_t prefix = prefixOf(bid.bidId);
+    BPlusPath path;
+    BPlusLeaf* leaf = findLeaf(bid.bidId, prefix, &path);
+    unsigned int pos = lowerBound(leaf, bid.bidId, prefix);
+    if (pos < leaf->count && leaf->bids[pos].bidId == bid.bidId) {
+        leaf->bids[pos] = bid;
+        return;
+    }
+    size++;
+    for (auto& step : path) {
+        step.first->counts[step.second]++;
+    }
+
+    if (leaf->count < BTREE_ORDER) {
+        insertInLeaf(leaf, pos, bid, prefix);
+        return;
+    }
+
+    // full, move the upper half to a new leaf linked in after this one
+    unsigned int half = BTREE_ORDER / 2;
+    BPlusLeaf* right = new BPlusLeaf();
+    for (unsigned int i = half; i < BTREE_ORDER; i++) {
+        right->prefixes[i - half] = leaf->prefixes[i];
+        right->bids[i - half] = std::move(leaf->bids[i]);
+    }
+    right->count = BTREE_ORDER - half;
+    leaf->count = half;
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next != nullptr) {
+        leaf->next->prev = right;
+    }
+    leaf->next = right;
+
+    if (pos <= half) {
+        insertInLeaf(leaf, pos, bid, prefix);
+    } else {
+        insertInLeaf(right, pos - half, bid, prefix);
+    }
+    insertSeparator(path, right->bids[0].bidId, right);
+}
+
+/**
+ * Load many bids at once. The bids are sorted if they are not already
+ * and merged with the tree's own, then packed into full leaves and the
+ * inner levels are built bottom up, one level at a time, in O(n). When
+ * an id appears more than once the last bid wins, as with Insert.
+ *
+ * @param bids The bids to add
+ */
+void BPlusTree::BulkLoad(vector<Bid> bids) {
+    auto byId = [](const Bid& a, const Bid& b) {
+        return a.bidId < b.bidId;
+    };
+    if (!is_sorted(bids.begin(), bids.end(), byId)) {
+        stable_sort(bids.begin(), bids.end(), byId);
+    }
+    if (size > 0) {
+        vector<Bid> current;
+        for (BPlusLeaf* leaf = firstLeaf(); leaf != nullptr; leaf = leaf->next) {
+            current.insert(current.end(), leaf->bids, leaf->bids + leaf->count);
+        }
+        vector<Bid> merged;
+        merged.reserve(current.size() + bids.size());
+        merge(current.begin(), current.end(), bids.begin(), bids.end(), back_inserter(merged), byId);
+        bids.swap(merged);
+    }
+    freeNodes();
+
+    // fill leaves left to right, a repeated id overwrites the one before it
+    vector<BPlusNode*> level;
+    BPlusLeaf* leaf = new BPlusLeaf();
+    level.push_back(leaf);
+    size = 0;
+    for (Bid& bid : bids) {
+        if (leaf->count > 0 && leaf->bids[leaf->count - 1].bidId == bid.bidId) {
+            leaf->bids[leaf->count - 1] = std::move(bid);
+            continue;
+        }
+        if (leaf->count == BTREE_ORDER) {
+            BPlusLeaf* next = new BPlusLeaf();
+            next->prev = leaf;
+            leaf->next = next;
+            leaf = next;
+            level.push_back(leaf);
+        }
+        leaf->prefixes[leaf->count] = prefixOf(bid.bidId);
+        leaf->bids[leaf->count] = std::move(bid);
+        leaf->count++;
+        size++;
+    }
+
+    // each inner level takes up to BTREE_ORDER + 1 nodes of the one below,
+    // separated by the smallest key under each node after the first. A lone
+    // node left over would give an inner node with no keys, so the last two
+    // groups split their nodes evenly instead
+    vector<string> lowest;
+    for (BPlusNode* node : level) {
+        lowest.push_back(((BPlusLeaf*) node)->bids[0].bidId);
+    }
+    while (level.size() > 1) {
+        vector<BPlusNode*> parents;
+        vector<string> parentLowest;
+        for (size_t first = 0, last; first < level.size(); first = last) {
+            last = min(level.size(), first + BTREE_ORDER + 1);
+            if (level.size() - first == BTREE_ORDER + 2) {
+                last = first + (BTREE_ORDER + 2) / 2;
+            }
+            BPlusInner* inner = new BPlusInner();
+            inner->children[0] = level[first];
+            inner->counts[0] = total(level[first]);
+            for (size_t i = first + 1; i < last; i++) {
+                inner->keys[inner->count] = lowest[i];
+                inner->prefixes[inner->count] = prefixOf(lowest[i]);
+                inner->children[inner->count + 1] = level[i];
+                inner->counts[inner->count + 1] = total(level[i]);
+                inner->count++;
+            }
+            parents.push_back(inner);
+            parentLowest.push_back(lowest[first]);
+        }
+        level.swap(parents);
+        lowest.swap(parentLowest);
+    }
+    root = level[0];
+}
+
+/**
+ * Remove a bid
+ */
+void BPlusTree::Remove(string bidId) {
+    uint64_t prefix = prefixOf(bidId);
+    BPlusPath path;
+    BPlusLeaf* leaf = findLeaf(bidId, prefix, &path);
+    unsigned int pos = lowerBound(leaf, bidId, prefix);
+    if (pos == leaf->count || leaf->bids[pos].bidId != bidId) {
+        return;
+    }
+    for (unsigned int i = pos; i + 1 < leaf->count; i++) {
+        leaf->prefixes[i] = leaf->prefixes[i + 1];
+        leaf->bids[i] = std::move(leaf->bids[i + 1]);
+    }
+    leaf->count--;
+    size--;
+    for (auto& step : path) {
+        step.first->counts[step.second]--;
+    }
+    if (leaf->count > 0 || leaf == root) {
+        return;
+    }
+
+    // the leaf is empty, unlink it and drop it from its parent, freeing
+    // any inner node that loses its only child on the way up
+    if (leaf->prev != nullptr) {
+        leaf->prev->next = leaf->next;
+    }
+    if (leaf->next != nullptr) {
+        leaf->next->prev = leaf->prev;
+    }
+    delete leaf;
+    while (!path.empty()) {
+        BPlusInner* parent = path.back().first;
+        unsigned int child = path.back().second;
+        path.pop_back();
+        if (parent->count > 0) {
+            removeFromInner(parent, child);
+            break;
+        }
+        if (parent == root) {
+            delete parent;
+            root = new BPlusLeaf();
+            return;
+        }
+        delete parent;
+    }
+
+    // a root left with one child hands over to it
+    while (!root->leaf && root->count == 0) {
+        BPlusInner* top = (BPlusInner*) root;
+        root = top->children[0];
+        delete top;
+    }
+}
+
+/**
+ * Find the bid with the specified bidId without copying it
+ *
+ * @param bidId The bid id to search for
+ * @return The bid in its leaf, nullptr if not found. It stays valid
+ *         until the next insert or remove, which may shift the leaf.
+ */
+const Bid* BPlusTree::Find(string_view bidId) {
+    uint64_t prefix = prefixOf(bidId);
+    BPlusLeaf* leaf = findLeaf(bidId, prefix, nullptr);
+    unsigned int pos = lowerBound(leaf, bidId, prefix);
+    if (pos < leaf->count && leaf->bids[pos].bidId == bidId) {
+        return &leaf->bids[pos];
+    }
+    return nullptr;
+}
+
+/**
+ * Search for a bid
+ */
+Bid BPlusTree::Search(string bidId) {
+    const Bid* found = Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+    Bid bid;
+    return bid;
+}
+
+/**
+ * Find many bids at once without copying them. Every leaf is at the
+ * same depth, so a group of lookups steps down one level per pass, and
+ * each lookup's next node is prefetched while the rest of the group
+ * searches theirs.
+ *
+ * @param bidIds The bid ids to search for
+ * @param results Filled with one pointer per id, nullptr if not found.
+ *         They stay valid until the next insert or remove.
+ */
+void BPlusTree::SearchBatch(const vector<string>& bidIds, vector<const Bid*>& results) {
+    results.assign(bidIds.size(), nullptr);
+
+    BPlusNode* current[BATCH_GROUP];
+    uint64_t prefixes[BATCH_GROUP];
+    for (size_t start = 0; start < bidIds.size(); start += BATCH_GROUP) {
+        size_t end = min(bidIds.size(), start + BATCH_GROUP);
+        for (size_t i = start; i < end; i++) {
+            current[i - start] = root;
+            prefixes[i - start] = prefixOf(bidIds[i]);
+        }
+
+        // the whole group reaches the leaves on the same pass
+        while (!current[0]->leaf) {
+            for (size_t i = start; i < end; i++) {
+                BPlusInner* inner = (BPlusInner*) current[i - start];
+                BPlusNode* child = inner->children[childFor(inner, bidIds[i], prefixes[i - start])];
+                // the header and the middle prefixes, where the search starts
+                PREFETCH(child);
+                PREFETCH(child->prefixes + BTREE_ORDER / 2);
+                current[i - start] = child;
+            }
+        }
+
+        for (size_t i = start; i < end; i++) {
+            BPlusLeaf* leaf = (BPlusLeaf*) current[i - start];
+            unsigned int pos = lowerBound(leaf, bidIds[i], prefixes[i - start]);
+            if (pos < leaf->count && leaf->bids[pos].bidId == bidIds[i]) {
+                results[i] = &leaf->bids[pos];
+            }
+        }
+    }
+}
+
+/**
+ * Print every bid in order by walking the linked leaves
+ */
+void BPlusTree::InOrder() {
+    for (BPlusLeaf* leaf = firstLeaf(); leaf != nullptr; leaf = leaf->next) {
+        for (unsigned int i = 0; i < leaf->count; i++) {
+            Bid& bid = leaf->bids[i];
+            cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | " << bid.fund << endl;
+        }
+    }
+}
+
+/**
+ * Pass every bid to a function in order by walking the linked leaves
+ */
+void BPlusTree::InOrder(void (*visit)(const Bid& bid)) {
+    for (BPlusLeaf* leaf = firstLeaf(); leaf != nullptr; leaf = leaf->next) {
+        for (unsigned int i = 0; i < leaf->count; i++) {
+            visit(leaf->bids[i]);
+        }
+    }
+}
+
+/**
+ * Returns the number of levels in the tree, every leaf is at the same depth
+ */
+int BPlusTree::Height() {
+    int levels = 1;
+    for (BPlusNode* node = root; !node->leaf; node = ((BPlusInner*) node)->children[0]) {
+        levels++;
+    }
+    return levels;
+}
+
+/**
+ * Returns the number of bids in the tree
+ */
+unsigned int BPlusTree::Size() {
+    return size;
+}
+
+/**
+ * Position a cursor at the first bid whose id is not less than bidId
+ */
+BidCursor BPlusTree::LowerBound(string bidId) {
+    uint64_t prefix = prefixOf(bidId);
+    BidCursor cursor;
+    cursor.leaf = findLeaf(bidId, prefix, nullptr);
+    cursor.index = lowerBound(cursor.leaf, bidId, prefix);
+    // past the end of this leaf, the next one starts with a larger id
+    if (cursor.index == cursor.leaf->count) {
+        cursor.leaf = cursor.leaf->next;
+        cursor.index = 0;
+    }
+    return cursor;
+}
+
+/**
+ * Position a cursor at the first bid whose id is greater than bidId
+ */
+BidCursor BPlusTree::UpperBound(string bidId) {
+    BidCursor cursor = LowerBound(bidId);
+    if (cursor.Valid() && cursor.Current().bidId == bidId) {
+        cursor.Next();
+    }
+    return cursor;
+}
+
+/**
+ * Position a cursor at the bid with the given position in id order,
+ * skipping whole children by their counts on the way down
+ */
+BidCursor BPlusTree::At(unsigned int position) {
+    BidCursor cursor;
+    if (position >= size) {
+        return cursor;
+    }
+    BPlusNode* node = root;
+    while (!node->leaf) {
+        BPlusInner* inner = (BPlusInner*) node;
+        unsigned int child = 0;
+        while (position >= inner->counts[child]) {
+            position -= inner->counts[child];
+            child++;
+        }
+        node = inner->children[child];
+    }
+    cursor.leaf = (BPlusLeaf*) node;
+    cursor.index = position;
+    return cursor;
+}
+
+/**
+ * Count the bids with ids less than (or also equal to) bidId, adding
+ * up the counts of the children left of the path down
+ */
+unsigned int BPlusTree::countBelow(string bidId, bool inclusive) {
+    uint64_t prefix = prefixOf(bidId);
+    unsigned int count = 0;
+    BPlusNode* node = root;
+    while (!node->leaf) {
+        BPlusInner* inner = (BPlusInner*) node;
+        unsigned int child = childFor(inner, bidId, prefix);
+        for (unsigned int i = 0; i < child; i++) {
+            count += inner->counts[i];
+        }
+        node = inner->children[child];
+    }
+    unsigned int pos = lowerBound(node, bidId, prefix);
+    if (inclusive && pos < node->count && keyAt(node, pos) == bidId) {
+        pos++;
+    }
+    return count + pos;
+}
+
+//============================================================================
+// Epoch based reclamation
+//============================================================================
+
+/**
+ * Define a class that tells writers when memory unlinked from a lock-free
+ * structure can be freed. Readers publish the global epoch they entered
+ * in, and anything retired in an epoch older than every active reader
+ * can no longer be reached.
+ */
+class EpochManager {
+
+private:
+    // one slot per reader thread, 0 means the thread is not reading
+    struct alignas(64) ReaderSlot {
+        atomic<uint64_t> epoch{ 0 };
+        atomic<bool> used{ false };
+    };
+
+    atomic<uint64_t> globalEpoch{ 1 };
+    ReaderSlot readers[MAX_READERS];
+
+public:
+    ReaderSlot& slotForThread();
+    void Enter();
+    void Exit();
+    uint64_t Advance();
+    uint64_t OldestActive();
+    void Release(ReaderSlot* slot);
+};
+
+/**
+ * Claim a reader slot the first time a thread reads and hand it back
+ * when the thread exits
+ */
+EpochManager::ReaderSlot& EpochManager::slotForThread() {
+    struct SlotOwner {
+        EpochManager* manager = nullptr;
+        ReaderSlot* slot = nullptr;
+        ~SlotOwner() {
+            if (slot != nullptr) {
+                manager->Release(slot);
+            }
+        }
+    };
+    thread_local SlotOwner owner;
+
+    if (owner.slot == nullptr) {
+        // keep trying, a slot frees up as soon as any reader thread exits
+        for (unsigned int i = 0; owner.slot == nullptr; i = (i + 1) % MAX_READERS) {
+            bool expected = false;
+            if (readers[i].used.compare_exchange_strong(expected, true)) {
+                owner.manager = this;
+                owner.slot = &readers[i];
+            }
+        }
+    }
+    return *owner.slot;
+}
+
+/**
+ * Mark the calling thread as reading in the current epoch
+ */
+void EpochManager::Enter() {
+    // sequentially consistent so writers scanning the slots either see
+    // this reader or the reader sees everything they unlinked
+    slotForThread().epoch.store(globalEpoch.load());
+}
+
+/**
+ * Mark the calling thread as no longer reading
+ */
+void EpochManager::Exit() {
+    slotForThread().epoch.store(0, memory_order_release);
+}
+
+/**
+ * Start a new epoch
+ *
+ * @return The epoch that just ended, to stamp retired memory with
+ */
+uint64_t EpochManager::Advance() {
+    return globalEpoch.fetch_add(1);
+}
+
+/**
+ * Returns the oldest epoch an active reader entered in,
+ * or UINT64_MAX if nobody is reading
+ */
+uint64_t EpochManager::OldestActive() {
+    uint64_t oldest = UINT64_MAX;
+    for (unsigned int i = 0; i < MAX_READERS; i++) {
+        uint64_t epoch = readers[i].epoch.load();
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+/**
+ * Give a reader slot back once its thread exits
+ */
+void EpochManager::Release(ReaderSlot* slot) {
+    slot->epoch.store(0);
+    slot->used.store(false);
+}
+
+//============================================================================
+// Concurrent Skip List class definition
+//============================================================================
+
+// skip list node, a bid and a tower of next pointers, one per level.
+// The tower is allocated in the same block as the bid, so each step
+// along a level costs one cache miss, not two. The bid never changes
+// once the node is linked in.
+struct SkipNode {
+    Bid bid;
+    unsigned int levels;
+    atomic<SkipNode*> next[1]; // really levels long
+
+    SkipNode(const Bid& aBid, unsigned int aLevels) : bid(aBid), levels(aLevels) {
+        for (unsigned int i = 0; i < aLevels; i++) {
+            new (&next[i]) atomic<SkipNode*>(nullptr);
+        }
+    }
+
+    /**
+     * Allocate a node with room for its whole tower
+     */
+    static SkipNode* Create(const Bid& bid, unsigned int levels) {
+        void* memory = ::operator new(sizeof(SkipNode) + (levels - 1) * sizeof(atomic<SkipNode*>));
+        return new (memory) SkipNode(bid, levels);
+    }
+
+    /**
+     * Free a node made by Create
+     */
+    static void Destroy(SkipNode* node) {
+        node->~SkipNode();
+        ::operator delete(node);
+    }
+};
+
+/**
+ * Define a class implementing an ordered bid index that can be searched
+ * and scanned while it is being loaded. Searches and range scans take
+ * no lock, they walk atomic next pointers. Writers serialize on one
+ * mutex and link a new node in bottom level first with release stores,
+ * so a reader that reaches it sees a complete bid. Removed or replaced
+ * nodes are unlinked and handed to an EpochManager, and only freed once
+ * no reader can still be standing on them.
+ */
+class ConcurrentSkipList {
+
+private:
+    // retired node with the epoch it was unlinked in
+    struct Retired {
+        uint64_t epoch;
+        SkipNode* node;
+    };
+
+    SkipNode* head;
+    atomic<unsigned int> levels{ 1 };
+    atomic<unsigned int> size{ 0 };
+    mutex writeLock;
+    mt19937 random;
+    vector<Retired> retired;
+
+    static EpochManager epochs;
+
+    unsigned int randomLevels();
+    SkipNode* findPreds(const string& bidId, SkipNode** preds);
+    void retire(SkipNode* node);
+    void reclaim(bool all);
+
+public:
+    ConcurrentSkipList();
+    virtual ~ConcurrentSkipList();
+    void Insert(Bid bid);
+    void Remove(string bidId);
+    Bid Search(string bidId);
+    vector<Bid> Range(string lowId, string highId);
+    unsigned int Size();
+};
+
+EpochManager ConcurrentSkipList::epochs;
+
+/**
+ * Default constructor, the head is a full height tower with no bid
+ */
+ConcurrentSkipList::ConcurrentSkipList() {
+    head = SkipNode::Create(Bid(), SKIP_MAX_LEVELS);
+}
+
+/**
+ * Destructor, no reader may still be using the list
+ */
+ConcurrentSkipList::~ConcurrentSkipList() {
+    reclaim(true);
+    SkipNode* node = head;
+    while (node != nullptr) {
+        SkipNode* nextNode = node->next[0].load(memory_order_relaxed);
+        SkipNode::Destroy(node);
+        node = nextNode;
+    }
+}
+
+/**
+ * Pick a height for a new node, each level up is SKIP_BRANCHING times
+ * less likely. Called with the write lock held.
+ */
+unsigned int ConcurrentSkipList::randomLevels() {
+    unsigned int height = 1;
+    while (height < SKIP_MAX_LEVELS && random() % SKIP_BRANCHING == 0) {
+        height++;
+    }
+    return height;
+}
+
+/**
+ * Find the last node before bidId on every level. Called with the
+ * write lock held, so nothing changes underneath.
+ *
+ * @param preds Filled with one node per level, SKIP_MAX_LEVELS long
+ * @return The node holding bidId, nullptr if there is none
+ */
+SkipNode* ConcurrentSkipList::findPreds(const string& bidId, SkipNode** preds) {
+    unsigned int top = levels.load(memory_order_relaxed);
+    for (unsigned int level = top; level < SKIP_MAX_LEVELS; level++) {
+        preds[level] = head;
+    }
+    SkipNode* node = head;
+    for (unsigned int level = top; level-- > 0;) {
+        SkipNode* nextNode = node->next[level].load(memory_order_relaxed);
+        while (nextNode != nullptr && nextNode->bid.bidId < bidId) {
+            node = nextNode;
+            nextNode = node->next[level].load(memory_order_relaxed);
+        }
+        preds[level] = node;
+    }
+    SkipNode* found = preds[0]->next[0].load(memory_order_relaxed);
+    return found != nullptr && found->bid.bidId == bidId ? found : nullptr;
+}
+
+/**
+ * Hand an unlinked node over to be freed once no reader can reach it.
+ * Called with the write lock held.
+ */
+void ConcurrentSkipList::retire(SkipNode* node) {
+    retired.push_back({ epochs.Advance(), node });
+    if (retired.size() >= RECLAIM_BATCH) {
+        reclaim(false);
+    }
+}
+
+/**
+ * Free retired nodes that no reader can reach anymore.
+ * Called with the write lock held.
+ *
+ * @param all Free everything regardless of readers (destructor only)
+ */
+void ConcurrentSkipList::reclaim(bool all) {
+    uint64_t oldest = all ? UINT64_MAX : epochs.OldestActive();
+
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < retired.size(); i++) {
+        // readers that entered after the retiring epoch never saw it
+        if (retired[i].epoch < oldest) {
+            SkipNode::Destroy(retired[i].node);
+        } else {
+            retired[kept++] = retired[i];
+        }
+    }
+    retired.resize(kept);
+}
+
+/**
+ * Insert a bid, replacing the bid with the same id if there is one
+ */
+void ConcurrentSkipList::Insert(Bid bid) {
+    lock_guard<mutex> guard(writeLock);
+
+    SkipNode* preds[SKIP_MAX_LEVELS];
+    SkipNode* old = findPreds(bid.bidId, preds);
+
+    // a replacement takes over the old tower, readers on either node
+    // carry on to the same successors
+    unsigned int height = old != nullptr ? old->levels : randomLevels();
+    SkipNode* node = SkipNode::Create(bid, height);
+    for (unsigned int level = 0; level < height; level++) {
+        SkipNode* nextNode = old != nullptr ? old->next[level].load(memory_order_relaxed)
+                : preds[level]->next[level].load(memory_order_relaxed);
+        node->next[level].store(nextNode, memory_order_relaxed);
+    }
+    if (height > levels.load(memory_order_relaxed)) {
+        levels.store(height, memory_order_release);
+    }
+
+    // bottom level first, a node reachable from above is always in the full list
+    for (unsigned int level = 0; level < height; level++) {
+        preds[level]->next[level].store(node, memory_order_release);
+    }
+
+    if (old != nullptr) {
+        retire(old);
+    } else {
+        size.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+/**
+ * Remove a bid
+ */
+void ConcurrentSkipList::Remove(string bidId) {
+    lock_guard<mutex> guard(writeLock);
+
+    SkipNode* preds[SKIP_MAX_LEVELS];
+    SkipNode* node = findPreds(bidId, preds);
+    if (node == nullptr) {
+        return;
+    }
+
+    // top level first, the node stays on the full list until it is
+    // gone from every shortcut, and readers already on it keep its links
+    for (unsigned int level = node->levels; level-- > 0;) {
+        preds[level]->next[level].store(node->next[level].load(memory_order_relaxed), memory_order_release);
+    }
+    size.fetch_sub(1, memory_order_relaxed);
+    retire(node);
+}
+
+/**
+ * Search for a bid without taking any lock
+ */
+Bid ConcurrentSkipList::Search(string bidId) {
+    Bid bid;
+
+    epochs.Enter();
+    SkipNode* node = head;
+    for (unsigned int level = levels.load(memory_order_acquire); level-- > 0;) {
+        SkipNode* nextNode = node->next[level].load(memory_order_acquire);
+        while (nextNode != nullptr && nextNode->bid.bidId < bidId) {
+            node = nextNode;
+            nextNode = node->next[level].load(memory_order_acquire);
+        }
+        if (nextNode != nullptr && nextNode->bid.bidId == bidId) {
+            bid = nextNode->bid;
+            break;
+        }
+    }
+    epochs.Exit();
+
+    return bid;
+}
+
+/**
+ * Collect the bids with ids from lowId to highId without taking any
+ * lock. Bids present for the whole scan are always returned, ones
+ * inserted or removed while it runs may or may not be.
+ *
+ * @param lowId The smallest id to include
+ * @param highId The largest id to include
+ * @return The bids in order of id
+ */
+vector<Bid> ConcurrentSkipList::Range(string lowId, string highId) {
+    vector<Bid> bids;
+
+    epochs.Enter();
+    SkipNode* node = head;
+    for (unsigned int level = levels.load(memory_order_acquire); level-- > 0;) {
+        SkipNode* nextNode = node->next[level].load(memory_order_acquire);
+        while (nextNode != nullptr && nextNode->bid.bidId < lowId) {
+            node = nextNode;
+            nextNode = node->next[level].load(memory_order_acquire);
+        }
+    }
+    for (node = node->next[0].load(memory_order_acquire); node != nullptr && node->bid.bidId <= highId;
+            node = node->next[0].load(memory_order_acquire)) {
+        bids.push_back(node->bid);
+    }
+    epochs.Exit();
+
+    return bids;
+}
+
+/**
+ * Returns the number of bids in the list
+ */
+unsigned int ConcurrentSkipList::Size() {
+    return size.load(memory_order_relaxed);
+}
+
+//============================================================================
+// Adaptive Radix Tree class definition
+//============================================================================
+
+// kinds of radix tree node, inner nodes are named for the children they hold
+enum RadixKind : uint8_t {
+    RADIX_LEAF, RADIX_NODE4, RADIX_NODE16, RADIX_NODE48, RADIX_NODE256
+};
+
+/**
+ * Define a class implementing an adaptive radix tree over string keys.
+ * Each inner node branches on one byte of the key and is only as big as
+ * its children need: up to 4 or 16 in sorted arrays, up to 48 behind a
+ * 256 byte index, or a full 256 way array. Bytes every key below a node
+ * shares are kept once in the node as a compressed prefix. A lookup or
+ * a prefix query walks at most one node per key byte, however many keys
+ * there are, and a prefix's keys are visited in sorted order, so a
+ * query costs O(prefix length + matches).
+ */
+template<class Value>
+class RadixTree {
+
+private:
+    struct Node {
+        RadixKind kind;
+
+        Node(RadixKind aKind) : kind(aKind) {
+        }
+    };
+
+    struct Leaf : Node {
+        string key;
+        Value value;
+
+        Leaf(const string& aKey, Value aValue) : Node(RADIX_LEAF), key(aKey), value(std::move(aValue)) {
+        }
+    };
+
+    // the bytes in prefix come next in every key below, then one byte picks the child
+    struct Inner : Node {
+        unsigned int count = 0;
+        string prefix;
+        Leaf* ends = nullptr; // the key that ends right after prefix
+
+        Inner(RadixKind aKind) : Node(aKind) {
+        }
+    };
+
+    // keys kept sorted, children[i] is under keys[i]
+    struct Node4 : Inner {
+        uint8_t keys[4];
+        Node* children[4];
+
+        Node4() : Inner(RADIX_NODE4) {
+        }
+    };
+
+    struct Node16 : Inner {
+        uint8_t keys[16];
+        Node* children[16];
+
+        Node16() : Inner(RADIX_NODE16) {
+        }
+    };
+
+    // index[byte] is the child's slot plus one, 0 for none
+    struct Node48 : Inner {
+        uint8_t index[256];
+        Node* children[48];
+
+        Node48() : Inner(RADIX_NODE48) {
+            fill(index, index + 256, 0);
+        }
+    };
+
+    struct Node256 : Inner {
+        Node* children[256];
+
+        Node256() : Inner(RADIX_NODE256) {
+            fill(children, children + 256, nullptr);
+        }
+    };
+
+    Node* root;
+    size_t size;
+
+    static Inner* newInner(RadixKind kind);
+    static void destroy(Node* node);
+    static void freeShell(Inner* node);
+    static size_t bytesUsed(Node* node);
+    static Node** findChild(Inner* node, uint8_t byte);
+    static void insertChild(Inner* node, uint8_t byte, Node* child);
+    static void eraseChild(Inner* node, uint8_t byte);
+    static void placeLeaf(Inner* node, Leaf* leaf, size_t depth);
+    static void addChild(Node** ref, uint8_t byte, Node* child);
+    static void removeChild(Node** ref, uint8_t byte);
+    static void collapse(Node** ref);
+    static void resize(Node** ref, RadixKind kind);
+    template<class Visit> static void forEachChild(Inner* node, Visit visit);
+    static bool collect(Node* node, vector<Value>& results, size_t limit);
+
+public:
+    RadixTree();
+    RadixTree(const RadixTree&) = delete;
+    RadixTree& operator=(const RadixTree&) = delete;
+    virtual ~RadixTree();
+    bool Insert(const string& key, Value value);
+    bool Remove(const string& key);
+    const Value* Search(string_view key) const;
+    vector<Value> WithPrefix(const string& prefix, size_t limit = SIZE_MAX) const;
+    void Clear();
+    size_t Size() const;
+    size_t MemoryBytes() const;
+};
+
+/**
+ * Default constructor
+ */
+template<class Value>
+RadixTree<Value>::RadixTree() {
+    root = nullptr;
+    size = 0;
+}
+
+/**
+ * Destructor
+ */
+template<class Value>
+RadixTree<Value>::~RadixTree() {
+    destroy(root);
+}
+
+/**
+ * Make an empty inner node of a kind
+ */
+template<class Value>
+typename RadixTree<Value>::Inner* RadixTree<Value>::newInner(RadixKind kind) {
+    switch (kind) {
+    case RADIX_NODE4:
+        return new Node4();
+    case RADIX_NODE16:
+        return new Node16();
+    case RADIX_NODE48:
+        return new Node48();
+    default:
+        return new Node256();
+    }
+}
+
+/**
+ * Free a subtree. Recursion is only as deep as the longest key.
+ */
+template<class Value>
+void RadixTree<Value>::destroy(Node* node) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->kind == RADIX_LEAF) {
+        delete (Leaf*) node;
+        return;
+    }
+    Inner* inner = (Inner*) node;
+    forEachChild(inner, [](uint8_t, Node* child) {
+        destroy(child);
+    });
+    destroy(inner->ends);
+    freeShell(inner);
+}
+
+/**
+ * Free an inner node alone, its children and ends belong elsewhere now
+ */
+template<class Value>
+void RadixTree<Value>::freeShell(Inner* node) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+        delete (Node4*) node;
+        break;
+    case RADIX_NODE16:
+        delete (Node16*) node;
+        break;
+    case RADIX_NODE48:
+        delete (Node48*) node;
+        break;
+    default:
+        delete (Node256*) node;
+    }
+}
+
+/**
+ * Returns the bytes taken by the nodes of a subtree and their strings,
+ * not counting memory the values point to
+ */
+template<class Value>
+size_t RadixTree<Value>::bytesUsed(Node* node) {
+    if (node == nullptr) {
+        return 0;
+    }
+    if (node->kind == RADIX_LEAF) {
+        Leaf* leaf = (Leaf*) node;
+        return sizeof(Leaf) + (leaf->key.capacity() > 15 ? leaf->key.capacity() + 1 : 0);
+    }
+    Inner* inner = (Inner*) node;
+    size_t bytes = inner->prefix.capacity() > 15 ? inner->prefix.capacity() + 1 : 0;
+    switch (inner->kind) {
+    case RADIX_NODE4:
+        bytes += sizeof(Node4);
+        break;
+    case RADIX_NODE16:
+        bytes += sizeof(Node16);
+        break;
+    case RADIX_NODE48:
+        bytes += sizeof(Node48);
+        break;
+    default:
+        bytes += sizeof(Node256);
+    }
+    forEachChild(inner, [&bytes](uint8_t, Node* child) {
+        bytes += bytesUsed(child);
+    });
+    return bytes + bytesUsed(inner->ends);
+}
+
+/**
+ * Find the child under a byte
+ *
+ * @return Where the child pointer is kept, nullptr if there is no child
+ */
+template<class Value>
+typename RadixTree<Value>::Node** RadixTree<Value>::findChild(Inner* node, uint8_t byte) {
+    switch (node->kind) {
+    case RADIX_NODE4: {
+        Node4* node4 = (Node4*) node;
+        for (unsigned int i = 0; i < node4->count; i++) {
+            if (node4->keys[i] == byte) {
+                return &node4->children[i];
+            }
+        }
+        return nullptr;
+    }
+    case RADIX_NODE16: {
+        // all 16 keys compared at once, the bits past count are dropped
+        Node16* node16 = (Node16*) node;
+#ifdef BINARYSEARCHTREE_SSE2
+        __m128i keys = _mm_loadu_si128((const __m128i*) node16->keys);
+        unsigned int matches = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8((char) byte)));
+        matches &= (1u << node16->count) - 1;
+        for (unsigned int i = 0; matches != 0; i++, matches >>= 1) {
+            if (matches & 1u) {
+                return &node16->children[i];
+            }
+        }
+#else
+        for (unsigned int i = 0; i < node16->count; i++) {
+            if (node16->keys[i] == byte) {
+                return &node16->children[i];
+            }
+        }
+#endif
+        return nullptr;
+    }
+    case RADIX_NODE48: {
+        Node48* node48 = (Node48*) node;
+        return node48->index[byte] == 0 ? nullptr : &node48->children[node48->index[byte] - 1];
+    }
+    default: {
+        Node256* node256 = (Node256*) node;
+        return node256->children[byte] == nullptr ? nullptr : &node256->children[byte];
+    }
+    }
+}
+
+/**
+ * Add a child under a byte the node has no child for, the node has room
+ */
+template<class Value>
+void RadixTree<Value>::insertChild(Inner* node, uint8_t byte, Node* child) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+    case RADIX_NODE16: {
+        // both keep their keys sorted, they differ only in length
+        uint8_t* keys = node->kind == RADIX_NODE4 ? ((Node4*) node)->keys : ((Node16*) node)->keys;
+        Node** children = node->kind == RADIX_NODE4 ? ((Node4*) node)->children : ((Node16*) node)->children;
+        unsigned int pos = node->count;
+        while (pos > 0 && keys[pos - 1] > byte) {
+            keys[pos] = keys[pos - 1];
+            children[pos] = children[pos - 1];
+            pos--;
+        }
+        keys[pos] = byte;
+        children[pos] = child;
+        break;
+    }
+    case RADIX_NODE48: {
+        // slots are packed, removal moves the last one into the gap
+        Node48* node48 = (Node48*) node;
+        node48->children[node->count] = child;
+        node48->index[byte] = (uint8_t) (node->count + 1);
+        break;
+    }
+    default:
+        ((Node256*) node)->children[byte] = child;
+    }
+    node->count++;
+}
+
+/**
+ * Drop the child under a byte, the caller frees it or moves it elsewhere
+ */
+template<class Value>
+void RadixTree<Value>::eraseChild(Inner* node, uint8_t byte) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+    case RADIX_NODE16: {
+        uint8_t* keys = node->kind == RADIX_NODE4 ? ((Node4*) node)->keys : ((Node16*) node)->keys;
+        Node** children = node->kind == RADIX_NODE4 ? ((Node4*) node)->children : ((Node16*) node)->children;
+        unsigned int pos = 0;
+        while (keys[pos] != byte) {
+            pos++;
+        }
+        for (; pos + 1 < node->count; pos++) {
+            keys[pos] = keys[pos + 1];
+            children[pos] = children[pos + 1];
+        }
+        break;
+    }
+    case RADIX_NODE48: {
+        Node48* node48 = (Node48*) node;
+        unsigned int slot = node48->index[byte] - 1;
+        unsigned int last = node->count - 1;
+        if (slot != last) {
+            // find the byte of the last slot to point it at the gap
+            for (unsigned int other = 0; other < 256; other++) {
+                if (node48->index[other] == last + 1) {
+                    node48->index[other] = (uint8_t) (slot + 1);
+                    break;
+                }
+            }
+            node48->children[slot] = node48->children[last];
+        }
+        node48->index[byte] = 0;
+        break;
+    }
+    default:
+        ((Node256*) node)->children[byte] = nullptr;
+    }
+    node->count--;
+}
+
+/**
+ * Put a leaf in a fresh node whose prefix ends at depth, under its next
+ * byte or as the key ending here
+ */
+template<class Value>
+void RadixTree<Value>::placeLeaf(Inner* node, Leaf* leaf, size_t depth) {
+    if (leaf->key.size() == depth) {
+        node->ends = leaf;
+    } else {
+        insertChild(node, (uint8_t) leaf->key[depth], leaf);
+    }
+}
+
+/**
+ * Add a child to the inner node at ref, moving it to the next bigger
+ * kind first if it is full
+ */
+template<class Value>
+void RadixTree<Value>::addChild(Node** ref, uint8_t byte, Node* child) {
+    Inner* node = (Inner*) *ref;
+    if (node->kind == RADIX_NODE4 && node->count == 4) {
+        resize(ref, RADIX_NODE16);
+    } else if (node->kind == RADIX_NODE16 && node->count == 16) {
+        resize(ref, RADIX_NODE48);
+    } else if (node->kind == RADIX_NODE48 && node->count == 48) {
+        resize(ref, RADIX_NODE256);
+    }
+    insertChild((Inner*) *ref, byte, child);
+}
+
+/**
+ * Drop a child from the inner node at ref, moving it to a smaller kind
+ * once it is well under the size it needs. The gap between growing and
+ * shrinking keeps a node from flipping back and forth.
+ */
+template<class Value>
+void RadixTree<Value>::removeChild(Node** ref, uint8_t byte) {
+    Inner* node = (Inner*) *ref;
+    eraseChild(node, byte);
+    if (node->kind == RADIX_NODE256 && node->count <= 36) {
+        resize(ref, RADIX_NODE48);
+    } else if (node->kind == RADIX_NODE48 && node->count <= 12) {
+        resize(ref, RADIX_NODE16);
+    } else if (node->kind == RADIX_NODE16 && node->count <= 3) {
+        resize(ref, RADIX_NODE4);
+    }
+}
+
+/**
+ * Replace an inner node left with a single way on: a lone key ending
+ * here becomes a leaf, a lone child takes the node's prefix and byte
+ */
+template<class Value>
+void RadixTree<Value>::collapse(Node** ref) {
+    Inner* node = (Inner*) *ref;
+    if (node->count == 0) {
+        *ref = node->ends;
+        freeShell(node);
+    } else if (node->count == 1 && node->ends == nullptr) {
+        uint8_t byte = 0;
+        Node* child = nullptr;
+        forEachChild(node, [&byte, &child](uint8_t childByte, Node* only) {
+            byte = childByte;
+            child = only;
+        });
+        if (child->kind != RADIX_LEAF) {
+            Inner* inner = (Inner*) child;
+            inner->prefix = node->prefix + (char) byte + inner->prefix;
+        }
+        *ref = child;
+        freeShell(node);
+    }
+}
+
+/**
+ * Move the inner node at ref into a new node of another kind
+ */
+template<class Value>
+void RadixTree<Value>::resize(Node** ref, RadixKind kind) {
+    Inner* node = (Inner*) *ref;
+    Inner* resized = newInner(kind);
+    resized->prefix = std::move(node->prefix);
+    resized->ends = node->ends;
+    forEachChild(node, [resized](uint8_t byte, Node* child) {
+        insertChild(resized, byte, child);
+    });
+    freeShell(node);
+    *ref = resized;
+}
+
+/**
+ * Pass each child of an inner node to visit(byte, child), in byte order
+ */
+template<class Value>
+template<class Visit>
+void RadixTree<Value>::forEachChild(Inner* node, Visit visit) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+        for (unsigned int i = 0; i < node->count; i++) {
+            visit(((Node4*) node)->keys[i], ((Node4*) node)->children[i]);
+        }
+        break;
+    case RADIX_NODE16:
+        for (unsigned int i = 0; i < node->count; i++) {
+            visit(((Node16*) node)->keys[i], ((Node16*) node)->children[i]);
+        }
+        break;
+    case RADIX_NODE48: {
+        Node48* node48 = (Node48*) node;
+        for (unsigned int byte = 0; byte < 256; byte++) {
+            if (node48->index[byte] != 0) {
+                visit((uint8_t) byte, node48->children[node48->index[byte] - 1]);
+            }
+        }
+        break;
+    }
+    default:
+        for (unsigned int byte = 0; byte < 256; byte++) {
+            if (((Node256*) node)->children[byte] != nullptr) {
+                visit((uint8_t) byte, ((Node256*) node)->children[byte]);
+            }
+        }
+    }
+}
+
+/**
+ * Append the values of a subtree in key order, a key ending at a node
+ * sorts before the longer keys under it
+ *
+ * @return false once limit values have been collected
+ */
+template<class Value>
+bool RadixTree<Value>::collect(Node* node, vector<Value>& results, size_t limit) {
+    if (results.size() >= limit) {
+        return false;
+    }
+    if (node->kind == RADIX_LEAF) {
+        results.push_back(((Leaf*) node)->value);
+        return results.size() < limit;
+    }
+    Inner* inner = (Inner*) node;
+    if (inner->ends != nullptr && !collect(inner->ends, results, limit)) {
+        return false;
+    }
+    bool more = true;
+    forEachChild(inner, [&](uint8_t, Node* child) {
+        more = more && collect(child, results, limit);
+    });
+    return more;
+}
+
+/**
+ * Insert a value, replacing the value already under the key if any
+ *
+ * @return true if the key is new
+ */
+template<class Value>
+bool RadixTree<Value>::Insert(const string& key, Value value) {
+    Node** ref = &root;
+    size_t depth = 0;
+    while (true) {
+        Node* node = *ref;
+        if (node == nullptr) {
+            *ref = new Leaf(key, std::move(value));
+            size++;
+            return true;
+        }
+
+        // a leaf in the way branches where the two keys part
+        if (node->kind == RADIX_LEAF) {
+            Leaf* leaf = (Leaf*) node;
+            if (leaf->key == key) {
+                leaf->value = std::move(value);
+                return false;
+            }
+            size_t common = depth;
+            while (common < key.size() && common < leaf->key.size() && key[common] == leaf->key[common]) {
+                common++;
+            }
+            Inner* branch = newInner(RADIX_NODE4);
+            branch->prefix = key.substr(depth, common - depth);
+            placeLeaf(branch, leaf, common);
+            placeLeaf(branch, new Leaf(key, std::move(value)), common);
+            *ref = branch;
+            size++;
+            return true;
+        }
+
+        // leaving the compressed prefix part way splits it there
+        Inner* inner = (Inner*) node;
+        size_t matched = 0;
+        while (matched < inner->prefix.size() && depth + matched < key.size()
+                && key[depth + matched] == inner->prefix[matched]) {
+            matched++;
+        }
+        if (matched < inner->prefix.size()) {
+            Inner* branch = newInner(RADIX_NODE4);
+            branch->prefix = inner->prefix.substr(0, matched);
+            uint8_t byte = (uint8_t) inner->prefix[matched];
+            inner->prefix.erase(0, matched + 1);
+            insertChild(branch, byte, inner);
+            placeLeaf(branch, new Leaf(key, std::move(value)), depth + matched);
+            *ref = branch;
+            size++;
+            return true;
+        }
+        depth += matched;
+
+        if (depth == key.size()) {
+            if (inner->ends != nullptr) {
+                inner->ends->value = std::move(value);
+                return false;
+            }
+            inner->ends = new Leaf(key, std::move(value));
+            size++;
+            return true;
+        }
+        Node** child = findChild(inner, (uint8_t) key[depth]);
+        if (child == nullptr) {
+            addChild(ref, (uint8_t) key[depth], new Leaf(key, std::move(value)));
+            size++;
+            return true;
+        }
+        ref = child;
+        depth++;
+    }
+}
+
+/**
+ * Remove a key, merging nodes that are left with a single way on
+ *
+ * @return true if the key was there
+ */
+template<class Value>
+bool RadixTree<Value>::Remove(const string& key) {
+    Node** parent = nullptr;
+    Node** ref = &root;
+    uint8_t byte = 0;
+    size_t depth = 0;
+    while (*ref != nullptr) {
+        Node* node = *ref;
+        if (node->kind == RADIX_LEAF) {
+            if (((Leaf*) node)->key != key) {
+                return false;
+            }
+            destroy(node);
+            size--;
+            if (parent == nullptr) {
+                root = nullptr;
+            } else {
+                removeChild(parent, byte);
+                collapse(parent);
+            }
+            return true;
+        }
+
+        Inner* inner = (Inner*) node;
+        if (key.compare(depth, inner->prefix.size(), inner->prefix) != 0) {
+            return false;
+        }
+        depth += inner->prefix.size();
+        if (depth == key.size()) {
+            if (inner->ends == nullptr) {
+                return false;
+            }
+            destroy(inner->ends);
+            inner->ends = nullptr;
+            size--;
+            collapse(ref);
+            return true;
+        }
+        Node** child = findChild(inner, (uint8_t) key[depth]);
+        if (child == nullptr) {
+            return false;
+        }
+        parent = ref;
+        byte = (uint8_t) key[depth];
+        ref = child;
+        depth++;
+    }
+    return false;
+}
+
+/**
+ * Search for the value under a key
+ *
+ * @return The value, nullptr if the key is not there
+ */
+template<class Value>
+const Value* RadixTree<Value>::Search(string_view key) const {
+    Node* node = root;
+    size_t depth = 0;
+    while (node != nullptr) {
+        // every byte on the way was matched, a leaf only checks the rest
+        if (node->kind == RADIX_LEAF) {
+            Leaf* leaf = (Leaf*) node;
+            return leaf->key == key ? &leaf->value : nullptr;
+        }
+        Inner* inner = (Inner*) node;
+        if (key.compare(depth, inner->prefix.size(), inner->prefix) != 0) {
+            return nullptr;
+        }
+        depth += inner->prefix.size();
+        if (depth == key.size()) {
+            return inner->ends != nullptr ? &inner->ends->value : nullptr;
+        }
+        Node** child = findChild(inner, (uint8_t) key[depth]);
+        if (child == nullptr) {
+            return nullptr;
+        }
+        node = *child;
+        depth++;
+    }
+    return nullptr;
+}
+
+/**
+ * Collect the values of every key starting with prefix, in key order
+ *
+ * @param prefix The start the keys share, empty for every key
+ * @param limit The most values to return
+ * @return The values, sorted by key
+ */
+template<class Value>
+vector<Value> RadixTree<Value>::WithPrefix(const string& prefix, size_t limit) const {
+    vector<Value> results;
+    Node* node = root;
+    size_t depth = 0;
+    while (node != nullptr) {
+        // the query ran out, everything below starts with it
+        if (depth == prefix.size()) {
+            collect(node, results, limit);
+            break;
+        }
+        if (node->kind == RADIX_LEAF) {
+            if (((Leaf*) node)->key.compare(0, prefix.size(), prefix) == 0) {
+                collect(node, results, limit);
+            }
+            break;
+        }
+
+        // the query may end part way through the compressed prefix
+        Inner* inner = (Inner*) node;
+        size_t length = min(inner->prefix.size(), prefix.size() - depth);
+        if (prefix.compare(depth, length, inner->prefix, 0, length) != 0) {
+            break;
+        }
+        depth += length;
+        if (depth == prefix.size()) {
+            collect(node, results, limit);
+            break;
+        }
+        Node** child = findChild(inner, (uint8_t) prefix[depth]);
+        if (child == nullptr) {
+            break;
+        }
+        node = *child;
+        depth++;
+    }
+    return results;
+}
+
+/**
+ * Remove every key
+ */
+template<class Value>
+void RadixTree<Value>::Clear() {
+    destroy(root);
+    root = nullptr;
+    size = 0;
+}
+
+/**
+ * Returns the number of keys
+ */
+template<class Value>
+size_t RadixTree<Value>::Size() const {
+    return size;
+}
+
+/**
+ * Returns the bytes taken by the tree's nodes and key strings, not
+ * counting memory the values point to
+ */
+template<class Value>
+size_t RadixTree<Value>::MemoryBytes() const {
+    return bytesUsed(root);
+}
+
+//============================================================================
+// Bid Snapshot class definition
+//============================================================================
+
+// Internal structure for a snapshot node. Nodes are never changed once
+// built, so any number of versions can point at the same one; the last
+// version to let go of a node frees it. The bid is shared the same way,
+// copying a node on an update does not copy its strings.
+struct SnapshotNode {
+    uint64_t prefix;
+    int32_t height;
+    unsigned int size;
+    shared_ptr<const SnapshotNode> left;
+    shared_ptr<const SnapshotNode> right;
+    shared_ptr<const Bid> bid;
+
+    SnapshotNode(shared_ptr<const Bid> aBid, shared_ptr<const SnapshotNode> aLeft,
+            shared_ptr<const SnapshotNode> aRight);
+    ~SnapshotNode();
+};
+
+/**
+ * Define a class implementing one version of a persistent AVL tree of
+ * bids. Insert and Remove leave the version they are called on as it
+ * was and return a new one: only the O(log n) nodes on the path to the
+ * change are copied, the rest are shared with the old version. Taking
+ * a snapshot is copying one pointer, old versions stay valid for
+ * rollback, and a version can be searched from any number of threads
+ * while updates build the next one.
+ */
+class BidSnapshot {
+
+private:
+    typedef shared_ptr<const SnapshotNode> NodePtr;
+
+    NodePtr root;
+
+    static atomic<size_t> liveNodes;
+
+    static int32_t height(const NodePtr& node);
+    static unsigned int size(const NodePtr& node);
+    static int compareKey(const SnapshotNode* node, string_view key, uint64_t prefix);
+    static NodePtr balance(shared_ptr<const Bid> bid, NodePtr left, NodePtr right);
+    static NodePtr insert(const NodePtr& node, shared_ptr<const Bid> bid, uint64_t prefix);
+    static NodePtr remove(const NodePtr& node, const string& bidId, uint64_t prefix, bool& removed);
+    static NodePtr removeMin(const NodePtr& node, shared_ptr<const Bid>& min);
+    static void range(const SnapshotNode* node, const string& lowId, const string& highId, vector<Bid>& bids);
+
+    friend struct SnapshotNode;
+
+public:
+    BidSnapshot();
+    BidSnapshot Insert(Bid bid) const;
+    BidSnapshot Remove(string bidId) const;
+    const Bid* Find(string_view bidId) const;
+    Bid Search(string bidId) const;
+    vector<Bid> Range(string lowId, string highId) const;
+    unsigned int Size() const;
+    int Height() const;
+    static size_t LiveNodes();
+};
+
+atomic<size_t> BidSnapshot::liveNodes(0);
+
+/**
+ * Build a node, working out its height and size from its children
+ */
+SnapshotNode::SnapshotNode(shared_ptr<const Bid> aBid, shared_ptr<const SnapshotNode> aLeft,
+        shared_ptr<const SnapshotNode> aRight) :
+        left(std::move(aLeft)), right(std::move(aRight)), bid(std::move(aBid)) {
+    prefix = prefixOf(bid->bidId);
+    height = 1 + max(BidSnapshot::height(left), BidSnapshot::height(right));
+    size = 1 + BidSnapshot::size(left) + BidSnapshot::size(right);
+    BidSnapshot::liveNodes.fetch_add(1, memory_order_relaxed);
+}
+
+/**
+ * Destructor
+ */
+SnapshotNode::~SnapshotNode() {
+    BidSnapshot::liveNodes.fetch_sub(1, memory_order_relaxed);
+}
+
+/**
+ * Default constructor, the empty version
+ */
+BidSnapshot::BidSnapshot() {
+}
+
+/**
+ * Returns the height of a subtree, 0 for none
+ */
+int32_t BidSnapshot::height(const NodePtr& node) {
+    return node ? node->height : 0;
+}
+
+/**
+ * Returns the number of bids in a subtree
+ */
+unsigned int BidSnapshot::size(const NodePtr& node) {
+    return node ? node->size : 0;
+}
+
+/**
+ * Compare a node's bid id with a key, prefixes first
+ *
+ * @return Negative, zero or positive as the node's id is less, equal or greater
+ */
+int BidSnapshot::compareKey(const SnapshotNode* node, string_view key, uint64_t prefix) {
+    if (node->prefix != prefix) {
+        return node->prefix < prefix ? -1 : 1;
+    }
+    return node->bid->bidId.compare(key);
+}
+
+/**
+ * Build a node over two subtrees whose heights differ by at most two,
+ * rotating new nodes into place if they differ by two. The subtrees are
+ * shared, never changed.
+ */
+BidSnapshot::NodePtr BidSnapshot::balance(shared_ptr<const Bid> bid, NodePtr left, NodePtr right) {
+    if (height(left) > height(right) + 1) {
+        // single right rotation, or a double one if the inner grandchild is taller
+        if (height(left->left) >= height(left->right)) {
+            return make_shared<const SnapshotNode>(left->bid, left->left,
+                    make_shared<const SnapshotNode>(std::move(bid), left->right, std::move(right)));
+        }
+        const NodePtr& middle = left->right;
+        return make_shared<const SnapshotNode>(middle->bid,
+                make_shared<const SnapshotNode>(left->bid, left->left, middle->left),
+                make_shared<const SnapshotNode>(std::move(bid), middle->right, std::move(right)));
+    }
+    if (height(right) > height(left) + 1) {
+        if (height(right->right) >= height(right->left)) {
+            return make_shared<const SnapshotNode>(right->bid,
+                    make_shared<const SnapshotNode>(std::move(bid), std::move(left), right->left), right->right);
+        }
+        const NodePtr& middle = right->left;
+        return make_shared<const SnapshotNode>(middle->bid,
+                make_shared<const SnapshotNode>(std::move(bid), std::move(left), middle->left),
+                make_shared<const SnapshotNode>(right->bid, middle->right, right->right));
+    }
+    return make_shared<const SnapshotNode>(std::move(bid), std::move(left), std::move(right));
+}
+
+/**
+ * Returns a copy of the path to where a bid belongs with the bid added,
+ * or replacing the bid with the same id
+ */
+BidSnapshot::NodePtr BidSnapshot::insert(const NodePtr& node, shared_ptr<const Bid> bid, uint64_t prefix) {
+    if (!node) {
+        return make_shared<const SnapshotNode>(std::move(bid), nullptr, nullptr);
+    }
+    int order = compareKey(node.get(), bid->bidId, prefix);
+    if (order > 0) {
+        return balance(node->bid, insert(node->left, std::move(bid), prefix), node->right);
+    }
+    if (order < 0) {
+        return balance(node->bid, node->left, insert(node->right, std::move(bid), prefix));
+    }
+    return make_shared<const SnapshotNode>(std::move(bid), node->left, node->right);
+}
+
+/**
+ * Returns a copy of the path to a bid with the bid taken out, or the
+ * subtree itself if the bid is not there
+ */
+BidSnapshot::NodePtr BidSnapshot::remove(const NodePtr& node, const string& bidId, uint64_t prefix, bool& removed) {
+    if (!node) {
+        return node;
+    }
+    int order = compareKey(node.get(), bidId, prefix);
+    if (order > 0) {
+        NodePtr left = remove(node->left, bidId, prefix, removed);
+        return removed ? balance(node->bid, std::move(left), node->right) : node;
+    }
+    if (order < 0) {
+        NodePtr right = remove(node->right, bidId, prefix, removed);
+        return removed ? balance(node->bid, node->left, std::move(right)) : node;
+    }
+    removed = true;
+    if (!node->left) {
+        return node->right;
+    }
+    if (!node->right) {
+        return node->left;
+    }
+    // the smallest bid on the right takes the removed bid's place
+    shared_ptr<const Bid> successor;
+    NodePtr right = removeMin(node->right, successor);
+    return balance(std::move(successor), node->left, std::move(right));
+}
+
+/**
+ * Returns a copy of the path to the smallest bid of a subtree with it
+ * taken out, handing the bid back in min
+ */
+BidSnapshot::NodePtr BidSnapshot::removeMin(const NodePtr& node, shared_ptr<const Bid>& min) {
+    if (!node->left) {
+        min = node->bid;
+        return node->right;
+    }
+    return balance(node->bid, removeMin(node->left, min), node->right);
+}
+
+/**
+ * Append the bids of a subtree with ids from lowId to highId, in order
+ */
+void BidSnapshot::range(const SnapshotNode* node, const string& lowId, const string& highId, vector<Bid>& bids) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->bid->bidId > lowId) {
+        range(node->left.get(), lowId, highId, bids);
+    }
+    if (node->bid->bidId >= lowId && node->bid->bidId <= highId) {
+        bids.push_back(*node->bid);
+    }
+    if (node->bid->bidId < highId) {
+        range(node->right.get(), lowId, highId, bids);
+    }
+}
+
+/**
+ * Returns a new version with a bid added, or replacing the bid with
+ * the same id. This version is left as it was.
+ *
+ * @param bid The bid to add
+ */
+BidSnapshot BidSnapshot::Insert(Bid bid) const {
+    BidSnapshot version;
+    uint64_t prefix = prefixOf(bid.bidId);
+    version.root = insert(root, make_shared<const Bid>(std::move(bid)), prefix);
+    return version;
+}
+
+/**
+ * Returns a new version without a bid. This version is left as it was.
+ *
+ * @param bidId The id of the bid to remove
+ */
+BidSnapshot BidSnapshot::Remove(string bidId) const {
+    BidSnapshot version;
+    bool removed = false;
+    version.root = remove(root, bidId, prefixOf(bidId), removed);
+    return version;
+}
+
+/**
+ * Find a bid in this version without copying it
+ *
+ * @param bidId The id of the bid to look for
+ * @return The bid, nullptr if it is not in this version. Bids are never
+ *         changed, so it stays valid as long as this version does.
+ */
+const Bid* BidSnapshot::Find(string_view bidId) const {
+    uint64_t prefix = prefixOf(bidId);
+    const SnapshotNode* node = root.get();
+    while (node != nullptr) {
+        int order = compareKey(node, bidId, prefix);
+        if (order == 0) {
+            return node->bid.get();
+        }
+        node = order > 0 ? node->left.get() : node->right.get();
+    }
+    return nullptr;
+}
+
+/**
+ * Search for a bid in this version
+ *
+ * @param bidId The id of the bid to look for
+ * @return The bid, empty if it is not in this version
  */
-BinarySearchTree::BinarySearchTree() {
-    // FixMe (1): initialize housekeeping variables
-    //root is equal to nullptr
-    root = nullptr;
+Bid BidSnapshot::Search(string bidId) const {
+    const Bid* found = Find(bidId);
+    if (found != nullptr) {
+        return *found;
+    }
+    Bid bid;
+    return bid;
 }
 
 /**
- * Destructor
+ * Returns the bids of this version with ids from lowId to highId, in order
  */
-BinarySearchTree::~BinarySearchTree() {
-    // recurse from root deleting every node
-    delete root->left;
-    delete root->right;
+vector<Bid> BidSnapshot::Range(string lowId, string highId) const {
+    vector<Bid> bids;
+    range(root.get(), lowId, highId, bids);
+    return bids;
 }
 
-void BinarySearchTree::InOrder() {
-    this->inOrder(root);
+/**
+ * Returns the number of bids in this version
+ */
+unsigned int BidSnapshot::Size() const {
+    return size(root);
 }
 
 /**
- * Insert a bid
+ * Returns the height of this version's tree
  */
-void BinarySearchTree::Insert(Bid bid) {
-    // FIXME (5) Implement inserting a bid into the tree
-    Node* newNode = new Node;
-    newNode->bid = bid;
-
-    // if root equarl to null ptr
-    if (root == nullptr) {
-        // root is equal to new node bid
-        root = newNode;
-        newNode->left = nullptr;
-        newNode->right = nullptr;
-    }
-    else {
-        // Create new node equal to root node
-        Node* currNode = root;
-
-        // Continue looping through tree until a proper spot has been found for the new node
-        while (currNode != nullptr) {
-            // LEFT branch
-            if (newNode->bid.bidId < currNode->bid.bidId) {
-                // IF no left node set it to the new node
-                if (currNode->left == nullptr) {
-                    currNode->left = newNode;
-                    currNode = nullptr;
-                }
-                // Set currNode to the new left node
-                else {
-                    currNode = currNode->left;
-                }
-            }
-            // RIGHT branch
-            else {
-                // IF no right node set it to the new node
-                if (currNode->right == nullptr) {
-                    currNode->right = newNode;
-                    currNode = nullptr;
-                }
-                // Set currNode to the new right node
-                else {
-                    currNode = currNode->right;
-                }
-            }
-            // Once a spot has been found for the new node, set its left & right nodes to nullptr as the newNode is a leaf node
-            newNode->left = nullptr;
-            newNode->right = nullptr;
-        }
-    }
+int BidSnapshot::Height() const {
+    return height(root);
 }
 
 /**
- * Remove a bid
+ * Returns the number of nodes held by all versions together, a node
+ * shared between versions counted once
  */
-void BinarySearchTree::Remove(string bidId) {
-    // FIXME (6) Implement removing a bid from the tree
-    // remove node root bidID
-    this->removeNode(root, bidId);
+size_t BidSnapshot::LiveNodes() {
+    return liveNodes.load(memory_order_relaxed);
 }
 
-Node* BinarySearchTree::removeNode(Node* node, string bidId) {
-     // if this node is null then return (avoid crashing)
-    if (node == nullptr) {
-        return node;
-    }
+//============================================================================
+// Bid Cursor methods, defined once both kinds of node are complete
+//============================================================================
 
-    // Recurse down left subtree
-    if (bidId < node->bid.bidId) {
-        node->left = removeNode(node->left, bidId);
-    }
-    // Recurse down right subtree
-    else if (bidId > node->bid.bidId) {
-        node->right = removeNode(node->right, bidId);
-    }
-    // ELSE correct node found
-    else {
-        // no children so this is a leaf node
-        if (node->left == nullptr && node->right == nullptr) {
-            delete node;
-            node = nullptr;
-        }
-        // one child to the left
-        else if (node->left != nullptr && node->right == nullptr) {
-            Node* temp = node;
-            node = node->left;
-            delete temp;
-        }
-        // one child to the right
-        else if (node->right != nullptr && node->left == nullptr) {
-            Node* temp = node;
-            node = node->right;
-            delete temp;
-        }
-        // two children
-        else {
-            Node* temp = node->right;
-            while (temp->left != nullptr) {
-                temp = temp->left;
-            }
-            node->bid = temp->bid;
-            node->right = removeNode(node->right, temp->bid.bidId);
-        }
-    }
-    return node;
+/**
+ * Returns true while the cursor is at a bid
+ */
+bool BidCursor::Valid() {
+    return leaf != nullptr ? index < leaf->count : !stack.empty();
 }
 
 /**
- * Search for a bid
+ * Returns the bid at the cursor, only while Valid
  */
-Bid BinarySearchTree::Search(string bidId) {
-    // FIXME (7) Implement searching the tree for a bid
-    // set current node equal to root
-    Node* currNode = root;
-
-    // keep looping downwards until bottom reached or matching bidId found
-    while (currNode != nullptr) {
-        // if match found, return current bid
-        if (currNode->bid.bidId == bidId) {
-            return currNode->bid;
-        }
-        // if bid is smaller than current node then traverse left
-        else if (bidId < currNode->bid.bidId) {
-            currNode = currNode->left;
-        }
-        // else larger so traverse right
-        else {
-            currNode = currNode->right;
-        }
-    }
-    // Bid not found, return empty bid
-    Bid bid;
-    return bid;
+const Bid& BidCursor::Current() {
+    return leaf != nullptr ? leaf->bids[index] : tree->nodeBids[stack.back()];
 }
 
-void BinarySearchTree::inOrder(Node* node) {
-    // FixMe (9): Pre order root
-    //if node is not equal to null ptr
-    if (node == nullptr) {
+/**
+ * Move to the bid with the next larger id
+ */
+void BidCursor::Next() {
+    if (leaf != nullptr) {
+        if (++index == leaf->count) {
+            leaf = leaf->next;
+            index = 0;
+        }
         return;
     }
 
-    //InOrder left
-    inOrder(node->left);
-    //output bidID, title, amount, fund
-    cout << node->bid.bidId << ": " << node->bid.title << " | " << node->bid.amount << " | " << node->bid.fund << endl;
-    //InOder right
-    inOrder(node->right);
+    // the successor is the leftmost node of the right subtree, or else
+    // the nearest ancestor still on the stack
+    uint32_t node = tree->nodes[stack.back()].right;
+    stack.pop_back();
+    while (node != NIL) {
+        stack.push_back(node);
+        node = tree->nodes[node].left;
+    }
 }
 
 //============================================================================
@@ -256,7 +3120,7 @@ void BinarySearchTree::inOrder(Node* node) {
  *
  * @param bid struct containing the bid info
  */
-void displayBid(Bid bid) {
+void displayBid(const Bid& bid) {
     cout << bid.bidId << ": " << bid.title << " | " << bid.amount << " | "
             << bid.fund << endl;
     return;
@@ -281,6 +3145,7 @@ void loadBids(string csvPath, BinarySearchTree* bst) {
     }
     cout << "" << endl;
 
+    vector<Bid> bids;
     try {
         // loop to read rows of a CSV file
         for (unsigned int i = 0; i < file.rowCount(); i++) {
@@ -295,11 +3160,569 @@ void loadBids(string csvPath, BinarySearchTree* bst) {
             //cout << "Item: " << bid.title << ", Fund: " << bid.fund << ", Amount: " << bid.amount << endl;
 
             // push this bid to the end
-            bst->Insert(bid);
+            bids.push_back(bid);
         }
     } catch (csv::Error &e) {
         std::cerr << e.what() << std::endl;
     }
+
+    // build the tree in one pass instead of one insert per bid
+    bst->BulkLoad(std::move(bids));
+}
+
+/**
+ * Shuffle generated ids, or bids, into the same pseudo-random order on
+ * every run so the benchmarks can be compared with each other
+ *
+ * @param items The ids or bids to shuffle in place
+ */
+template<class T>
+void shuffleIds(vector<T>& items) {
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = items.size(); i-- > 1;) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        swap(items[i], items[state % (i + 1)]);
+    }
+}
+
+/**
+ * Returns a generated id padded with zeros to 10 digits, ids padded to
+ * the same length sort in numeric order
+ */
+string paddedId(uint64_t i) {
+    string id = to_string(i);
+    return string(10 - id.size(), '0') + id;
+}
+
+/**
+ * Compare a loop of single searches, which copy each bid out, a loop
+ * of finds, which do not, and one batch find over a tree of generated
+ * bids inserted in random order
+ *
+ * @param count The number of generated bids to load
+ */
+void benchmarkBatchSearch(unsigned int count) {
+    // shuffle the ids so the tree stays reasonably balanced
+    vector<string> bidIds;
+    for (unsigned int i = 0; i < count; i++) {
+        bidIds.push_back(to_string(i));
+    }
+    shuffleIds(bidIds);
+
+    // titles as long as real ones, too long to fit inside the string
+    BinarySearchTree tree;
+    for (unsigned int i = 0; i < count; i++) {
+        Bid bid;
+        bid.bidId = bidIds[i];
+        bid.title = "Dell Optiplex 760 Computer";
+        bid.fund = "General Fund";
+        tree.Insert(bid);
+    }
+
+    // search in a different random order than the inserts
+    reverse(bidIds.begin(), bidIds.end());
+    vector<Bid> results(count);
+
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        results[i] = tree.Search(bidIds[i]);
+    }
+    auto end = chrono::steady_clock::now();
+    double singleNs = chrono::duration<double, nano>(end - start).count() / count;
+
+    unsigned int found = 0;
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i++) {
+        found += tree.Find(bidIds[i]) != nullptr;
+    }
+    end = chrono::steady_clock::now();
+    double findNs = chrono::duration<double, nano>(end - start).count() / count;
+
+    vector<const Bid*> batch;
+    start = chrono::steady_clock::now();
+    tree.SearchBatch(bidIds, batch);
+    end = chrono::steady_clock::now();
+    double batchNs = chrono::duration<double, nano>(end - start).count() / count;
+
+    cout << count << " bids: single search " << singleNs << " ns | single find " << findNs << " ns ("
+            << found << " found) | batch find " << batchNs << " ns" << endl;
+}
+
+/**
+ * Load sorted, reverse sorted and random bid ids into a plain and a
+ * balanced tree, and time the inserts and searches of each
+ *
+ * @param count The number of generated bids to load
+ */
+void benchmarkBalance(unsigned int count) {
+    // ids of one length so string order matches number order
+    vector<string> sorted;
+    for (unsigned int i = 0; i < count; i++) {
+        sorted.push_back(to_string(10000000 + i));
+    }
+    vector<string> reversed(sorted.rbegin(), sorted.rend());
+    vector<string> shuffled = sorted;
+    shuffleIds(shuffled);
+
+    vector<string>* orders[] = { &sorted, &reversed, &shuffled };
+    string orderNames[] = { "Sorted", "Reversed", "Random" };
+    for (int order = 0; order < 3; order++) {
+        for (int balanced = 0; balanced < 2; balanced++) {
+            BinarySearchTree tree(balanced == 1);
+            vector<string>& bidIds = *orders[order];
+
+            auto start = chrono::steady_clock::now();
+            for (unsigned int i = 0; i < count; i++) {
+                Bid bid;
+                bid.bidId = bidIds[i];
+                tree.Insert(bid);
+            }
+            auto end = chrono::steady_clock::now();
+            double insertNs = chrono::duration<double, nano>(end - start).count() / count;
+
+            unsigned int found = 0;
+            start = chrono::steady_clock::now();
+            for (unsigned int i = 0; i < count; i++) {
+                if (tree.Find(shuffled[i]) != nullptr) {
+                    found++;
+                }
+            }
+            end = chrono::steady_clock::now();
+            double searchNs = chrono::duration<double, nano>(end - start).count() / count;
+
+            cout << orderNames[order] << (balanced == 1 ? " balanced: " : " plain: ") << "height " << tree.Height()
+                    << " | insert " << insertNs << " ns | search " << searchNs << " ns | " << found << " found" << endl;
+        }
+    }
+}
+
+/**
+ * Time building trees from sorted and shuffled bids one insert at a
+ * time against one BulkLoad
+ *
+ * @param count The number of generated bids to load
+ */
+void benchmarkBulkLoad(unsigned int count) {
+    // ids of one length so string order matches number order
+    vector<Bid> sorted(count);
+    for (unsigned int i = 0; i < count; i++) {
+        sorted[i].bidId = to_string(10000000 + i);
+    }
+    vector<Bid> shuffled = sorted;
+    shuffleIds(shuffled);
+
+    vector<Bid>* orders[] = { &sorted, &shuffled };
+    string orderNames[] = { "Sorted", "Random" };
+    string treeNames[] = { " balanced tree", " B+ tree" };
+    for (int order = 0; order < 2; order++) {
+        for (int t = 0; t < 2; t++) {
+            BinarySearchTree* inserted = t == 0 ? new BinarySearchTree(true) : new BPlusTree();
+            auto start = chrono::steady_clock::now();
+            for (Bid& bid : *orders[order]) {
+                inserted->Insert(bid);
+            }
+            auto end = chrono::steady_clock::now();
+            double insertMs = chrono::duration<double, milli>(end - start).count();
+            int insertedHeight = inserted->Height();
+            delete inserted;
+
+            // hand over a copy, as loadBids hands over the bids it read
+            vector<Bid> bids = *orders[order];
+            BinarySearchTree* loaded = t == 0 ? new BinarySearchTree(true) : new BPlusTree();
+            start = chrono::steady_clock::now();
+            loaded->BulkLoad(std::move(bids));
+            end = chrono::steady_clock::now();
+            double loadMs = chrono::duration<double, milli>(end - start).count();
+
+            cout << orderNames[order] << treeNames[t] << ": inserts " << insertMs << " ms, height "
+                    << insertedHeight << " | bulk load " << loadMs << " ms, height " << loaded->Height() << endl;
+            delete loaded;
+        }
+    }
+}
+
+// running total for the scans timed by benchmarkBPlusTree
+double scanTotal = 0.0;
+
+/**
+ * Add a bid's amount to the scan total
+ */
+void addAmount(const Bid& bid) {
+    scanTotal += bid.amount;
+}
+
+/**
+ * Time searches and full in-order scans of a balanced binary tree
+ * against the B+ tree, both loaded with the same random order
+ *
+ * @param count The number of generated bids to load
+ */
+void benchmarkBPlusTree(unsigned int count) {
+    // ids of one length so string order matches number order
+    vector<string> bidIds;
+    for (unsigned int i = 0; i < count; i++) {
+        bidIds.push_back(to_string(10000000 + i));
+    }
+    shuffleIds(bidIds);
+    vector<string> searchIds(bidIds.rbegin(), bidIds.rend());
+
+    BinarySearchTree* trees[] = { new BinarySearchTree(true), new BPlusTree() };
+    string names[] = { "Balanced binary tree", "B+ tree" };
+    for (int t = 0; t < 2; t++) {
+        auto start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; i++) {
+            Bid bid;
+            bid.bidId = bidIds[i];
+            bid.amount = i;
+            trees[t]->Insert(bid);
+        }
+        auto end = chrono::steady_clock::now();
+        double insertNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        // search in a different random order than the inserts
+        unsigned int found = 0;
+        start = chrono::steady_clock::now();
+        for (unsigned int i = 0; i < count; i++) {
+            if (trees[t]->Find(searchIds[i]) != nullptr) {
+                found++;
+            }
+        }
+        end = chrono::steady_clock::now();
+        double searchNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        vector<const Bid*> batch;
+        start = chrono::steady_clock::now();
+        trees[t]->SearchBatch(searchIds, batch);
+        end = chrono::steady_clock::now();
+        double batchNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        scanTotal = 0.0;
+        start = chrono::steady_clock::now();
+        trees[t]->InOrder(addAmount);
+        end = chrono::steady_clock::now();
+        double scanNs = chrono::duration<double, nano>(end - start).count() / count;
+
+        cout << names[t] << ": height " << trees[t]->Height() << " | insert " << insertNs << " ns | search "
+                << searchNs << " ns | batch " << batchNs << " ns | scan " << scanNs << " ns per bid | "
+                << found << " found" << endl;
+        delete trees[t];
+    }
+}
+
+/**
+ * Compare an AVL tree behind a reader/writer lock with the concurrent
+ * skip list as more threads share them. Each thread mixes searches and
+ * short range scans with inserts and removes over zero padded ids.
+ *
+ * @param count Bids loaded before the threads start
+ */
+void benchmarkConcurrentIndex(unsigned int count) {
+    const unsigned int opsPerThread = 100000;
+    const unsigned int scanWidth = 20;
+    int readPercents[] = { 100, 95, 50 };
+    string names[] = { "Locked AVL", "Skip list" };
+
+    for (int readPercent : readPercents) {
+        for (int engine = 0; engine < 2; engine++) {
+            for (unsigned int threads = 1; threads <= 16; threads *= 2) {
+                BinarySearchTree tree(true);
+                shared_mutex treeLock;
+                ConcurrentSkipList list;
+                // every other id, so half the searches miss
+                for (unsigned int i = 0; i < count; i += 2) {
+                    Bid bid;
+                    bid.bidId = paddedId(i);
+                    if (engine == 0) {
+                        tree.Insert(bid);
+                    } else {
+                        list.Insert(bid);
+                    }
+                }
+
+                auto start = chrono::steady_clock::now();
+                vector<thread> workers;
+                for (unsigned int t = 0; t < threads; t++) {
+                    workers.push_back(thread([&, t]() {
+                        // cheap per thread random numbers, no shared state
+                        uint64_t state = 0x9e3779b97f4a7c15ULL * (t + 1);
+                        for (unsigned int i = 0; i < opsPerThread; i++) {
+                            state ^= state << 13;
+                            state ^= state >> 7;
+                            state ^= state << 17;
+                            uint64_t key = state % count;
+                            string bidId = paddedId(key);
+                            // one read in 16 is a range scan
+                            if ((int) (state >> 40) % 100 < readPercent) {
+                                if (i % 16 == 0) {
+                                    if (engine == 0) {
+                                        shared_lock<shared_mutex> guard(treeLock);
+                                        tree.Range(bidId, paddedId(key + scanWidth));
+                                    } else {
+                                        list.Range(bidId, paddedId(key + scanWidth));
+                                    }
+                                } else if (engine == 0) {
+                                    shared_lock<shared_mutex> guard(treeLock);
+                                    tree.Find(bidId);
+                                } else {
+                                    list.Search(bidId);
+                                }
+                            }
+                            else if (i % 2 == 0) {
+                                Bid bid;
+                                bid.bidId = bidId;
+                                if (engine == 0) {
+                                    unique_lock<shared_mutex> guard(treeLock);
+                                    tree.Insert(bid);
+                                } else {
+                                    list.Insert(bid);
+                                }
+                            }
+                            else if (engine == 0) {
+                                unique_lock<shared_mutex> guard(treeLock);
+                                tree.Remove(bidId);
+                            } else {
+                                list.Remove(bidId);
+                            }
+                        }
+                    }));
+                }
+                for (thread& worker : workers) {
+                    worker.join();
+                }
+                auto end = chrono::steady_clock::now();
+
+                double seconds = chrono::duration<double>(end - start).count();
+                cout << names[engine] << ", " << readPercent << "% reads, " << threads << " threads: "
+                        << threads * opsPerThread / seconds / 1e6 << " million ops/s" << endl;
+            }
+        }
+    }
+}
+
+/**
+ * Fill the radix tree over bid ids from the bids in a tree. Each value
+ * is the bid's id, which stays a valid handle for bst->Find however the
+ * tree moves its bids, so later changes only insert or remove one key.
+ *
+ * @param bst The tree holding the bids
+ * @param ids The radix tree to refill
+ */
+void indexBidIds(BinarySearchTree* bst, RadixTree<string>& ids) {
+    ids.Clear();
+    for (BidCursor cursor = bst->LowerBound(""); cursor.Valid(); cursor.Next()) {
+        ids.Insert(cursor.Current().bidId, cursor.Current().bidId);
+    }
+}
+
+/**
+ * Compare the radix tree over bid ids with the balanced tree, for exact
+ * lookups and for the bids under a prefix
+ *
+ * @param count The number of bids in each index
+ */
+void benchmarkPrefixIndex(unsigned int count) {
+    // ids of one length, so a 6 digit prefix covers 100 bids
+    vector<string> ids(count);
+    for (unsigned int i = 0; i < count; i++) {
+        ids[i] = to_string(10000000 + i);
+    }
+    shuffleIds(ids);
+
+    BinarySearchTree tree(true);
+    RadixTree<string> radix;
+    for (string& id : ids) {
+        Bid bid;
+        bid.bidId = id;
+        tree.Insert(bid);
+        radix.Insert(id, id);
+    }
+
+    unsigned int found = 0;
+    auto start = chrono::steady_clock::now();
+    for (string& id : ids) {
+        found += tree.Find(id) != nullptr;
+    }
+    auto end = chrono::steady_clock::now();
+    double treeNs = chrono::duration<double, nano>(end - start).count() / count;
+    start = chrono::steady_clock::now();
+    for (string& id : ids) {
+        found += radix.Search(id) != nullptr;
+    }
+    end = chrono::steady_clock::now();
+    double radixNs = chrono::duration<double, nano>(end - start).count() / count;
+    cout << "Exact lookups: balanced tree " << treeNs << " ns, radix tree " << radixNs << " ns ("
+            << found << " found)" << endl;
+
+    // the tree seeks the prefix and walks while ids still start with it,
+    // both sides hand back the matching ids
+    unsigned int queries = count / 100;
+    size_t matched = 0;
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < queries; i++) {
+        string prefix = ids[i].substr(0, 6);
+        vector<string> matches;
+        for (BidCursor cursor = tree.LowerBound(prefix);
+                cursor.Valid() && cursor.Current().bidId.compare(0, prefix.size(), prefix) == 0; cursor.Next()) {
+            matches.push_back(cursor.Current().bidId);
+        }
+        matched += matches.size();
+    }
+    end = chrono::steady_clock::now();
+    treeNs = chrono::duration<double, nano>(end - start).count() / queries;
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < queries; i++) {
+        matched += radix.WithPrefix(ids[i].substr(0, 6)).size();
+    }
+    end = chrono::steady_clock::now();
+    radixNs = chrono::duration<double, nano>(end - start).count() / queries;
+    cout << "Prefix queries: balanced tree " << treeNs << " ns, radix tree " << radixNs << " ns ("
+            << matched << " bids matched)" << endl;
+
+    cout << "Radix tree: " << radix.MemoryBytes() * 1.0 / count << " bytes per bid" << endl;
+}
+
+/**
+ * Apply updates to a persistent tree while a second thread searches the
+ * version from before them, then roll every update back
+ *
+ * @param count The number of bids in the first version
+ */
+void benchmarkSnapshots(unsigned int count) {
+    const unsigned int updates = 10000;
+
+    // every other id, the rest are left for the updates to add
+    BidSnapshot base;
+    auto start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < count; i += 2) {
+        Bid bid;
+        bid.bidId = paddedId(i);
+        base = base.Insert(bid);
+    }
+    auto end = chrono::steady_clock::now();
+    size_t baseNodes = BidSnapshot::LiveNodes();
+    cout << "Built " << base.Size() << " bids in " << chrono::duration<double, milli>(end - start).count()
+            << " ms, height " << base.Height() << endl;
+
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < updates; i++) {
+        BidSnapshot snapshot = base;
+        if (snapshot.Size() != base.Size()) {
+            break;
+        }
+    }
+    end = chrono::steady_clock::now();
+    cout << "Snapshot: " << chrono::duration<double, nano>(end - start).count() / updates << " ns" << endl;
+
+    // the reader keeps its own copy of the first version, whatever the writer does
+    atomic<bool> writing(true);
+    unsigned int reads = 0, wrong = 0;
+    thread reader([&]() {
+        BidSnapshot reading = base;
+        uint64_t state = 0x9e3779b97f4a7c15ULL;
+        while (writing.load(memory_order_acquire) || reads < updates) {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            uint64_t key = state % count;
+            bool found = reading.Find(paddedId(key)) != nullptr;
+            wrong += found != (key % 2 == 0);
+            reads++;
+        }
+    });
+
+    // every version is kept, half the updates add an odd id and half remove an even one
+    vector<BidSnapshot> versions;
+    versions.push_back(base);
+    uint64_t state = 0x2545f4914f6cdd1dULL;
+    start = chrono::steady_clock::now();
+    for (unsigned int i = 0; i < updates; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        uint64_t key = state % (count / 2) * 2;
+        if (i % 2 == 0) {
+            Bid bid;
+            bid.bidId = paddedId(key + 1);
+            versions.push_back(versions.back().Insert(bid));
+        } else {
+            versions.push_back(versions.back().Remove(paddedId(key)));
+        }
+    }
+    end = chrono::steady_clock::now();
+    writing.store(false, memory_order_release);
+    reader.join();
+
+    cout << "Updates: " << chrono::duration<double, nano>(end - start).count() / updates << " ns each, "
+            << (BidSnapshot::LiveNodes() - baseNodes) * 1.0 / updates << " new nodes each with "
+            << updates + 1 << " versions kept" << endl;
+    cout << "Reader: " << reads << " searches of the first version, " << wrong << " wrong" << endl;
+
+    // rolling back is dropping the newer versions, their nodes go with them
+    versions.resize(1);
+    cout << "Rolled back to " << versions.back().Size() << " bids, " << BidSnapshot::LiveNodes() - baseNodes
+            << " nodes left over" << endl;
+}
+
+/**
+ * Display the bids with ids in a range, then page through all of them
+ *
+ * @param bst The tree holding the bids
+ */
+void browseBids(BinarySearchTree* bst) {
+    string lowId, highId;
+    cout << "Enter lowest and highest bid id: ";
+    cin >> lowId >> highId;
+    vector<Bid> bids = bst->Range(lowId, highId);
+    for (Bid& bid : bids) {
+        displayBid(bid);
+    }
+    cout << bids.size() << " bids from " << lowId << " to " << highId << endl;
+}
+
+/**
+ * Page through every bid in order. Pages are found by position, so any
+ * page can be jumped to as cheaply as the first.
+ *
+ * @param bst The tree holding the bids
+ * @param pageSize Bids per page
+ */
+void pageBids(BinarySearchTree* bst, unsigned int pageSize) {
+    unsigned int pages = (bst->Size() + pageSize - 1) / pageSize;
+    unsigned int pageNumber = 1;
+    while (pageNumber >= 1 && pageNumber <= pages) {
+        vector<Bid> page = bst->PageAt(pageNumber - 1, pageSize);
+        for (Bid& bid : page) {
+            displayBid(bid);
+        }
+        cout << "Page " << pageNumber << " of " << pages << endl;
+        cout << "Go to page (0 to stop): ";
+        cin >> pageNumber;
+    }
+}
+
+/**
+ * Display the bids whose ids start with what the user enters
+ *
+ * @param bst The tree holding the bids
+ * @param ids The radix tree over bid ids
+ */
+void findBidsByPrefix(BinarySearchTree* bst, RadixTree<string>& ids) {
+    string prefix;
+    cout << "Enter start of bid id: ";
+    cin >> prefix;
+    auto start = chrono::steady_clock::now();
+    vector<string> bidIds = ids.WithPrefix(prefix);
+    auto end = chrono::steady_clock::now();
+    for (string& bidId : bidIds) {
+        const Bid* bid = bst->Find(bidId);
+        if (bid != nullptr) {
+            displayBid(*bid);
+        }
+    }
+    cout << bidIds.size() << " bids starting with " << prefix << ", found in "
+            << chrono::duration<double, micro>(end - start).count() << " microseconds" << endl;
 }
 
 /**
@@ -321,8 +3744,13 @@ double strToDouble(string str, char ch) {
 int main(int argc, char* argv[]) {
 
     // process command line arguments
-    string csvPath, bidKey;
+    string csvPath, bidKey, mode;
     switch (argc) {
+    case 4:
+        csvPath = argv[1];
+        bidKey = argv[2];
+        mode = argv[3];
+        break;
     case 2:
         csvPath = argv[1];
         bidKey = "98109";
@@ -339,10 +3767,20 @@ int main(int argc, char* argv[]) {
     // Define a timer variable
     clock_t ticks;
 
-    // Define a binary search tree to hold all bids
+    // Define a binary search tree to hold all bids, AVL balanced
+    // unless "plain" is given after the bid key, or a B+ tree for "bplus"
     BinarySearchTree* bst;
-    bst = new BinarySearchTree();
+    if (mode == "bplus") {
+        bst = new BPlusTree();
+    } else {
+        bst = new BinarySearchTree(mode != "plain");
+    }
     Bid bid;
+    const Bid* found;
+
+    // radix tree over the bid ids for prefix queries, refilled on each
+    // load and kept up to date on each remove
+    RadixTree<string> bidIds;
 
     int choice = 0;
     while (choice != 9) {
@@ -351,6 +3789,16 @@ int main(int argc, char* argv[]) {
         cout << "  2. Display All Bids" << endl;
         cout << "  3. Find Bid" << endl;
         cout << "  4. Remove Bid" << endl;
+        cout << "  5. Benchmark Batch Search" << endl;
+        cout << "  6. Benchmark Balanced Tree" << endl;
+        cout << "  7. Benchmark B+ Tree" << endl;
+        cout << "  8. Display Bid Range" << endl;
+        cout << "  10. Page Through Bids" << endl;
+        cout << "  11. Benchmark Bulk Load" << endl;
+        cout << "  12. Benchmark Concurrent Index" << endl;
+        cout << "  13. Find Bids by Prefix" << endl;
+        cout << "  14. Benchmark Prefix Index" << endl;
+        cout << "  15. Benchmark Snapshots" << endl;
         cout << "  9. Exit" << endl;
         cout << "Enter choice: ";
         cin >> choice;
@@ -364,6 +3812,7 @@ int main(int argc, char* argv[]) {
 
             // Complete the method call to load the bids
             loadBids(csvPath, bst);
+            indexBidIds(bst, bidIds);
 
             //cout << bst->Size() << " bids read" << endl;
 
@@ -380,12 +3829,12 @@ int main(int argc, char* argv[]) {
         case 3:
             ticks = clock();
 
-            bid = bst->Search(bidKey);
+            found = bst->Find(bidKey);
 
             ticks = clock() - ticks; // current clock ticks minus starting clock ticks
 
-            if (!bid.bidId.empty()) {
-                displayBid(bid);
+            if (found != nullptr) {
+                displayBid(*found);
             } else {
             	cout << "Bid Id " << bidKey << " not found." << endl;
             }
@@ -397,10 +3846,53 @@ int main(int argc, char* argv[]) {
 
         case 4:
             bst->Remove(bidKey);
+            bidIds.Remove(bidKey);
+            break;
+
+        case 5:
+            benchmarkBatchSearch(1000000);
+            break;
+
+        case 6:
+            benchmarkBalance(20000);
+            break;
+
+        case 7:
+            benchmarkBPlusTree(1000000);
+            break;
+
+        case 8:
+            browseBids(bst);
+            break;
+
+        case 10:
+            pageBids(bst, 20);
+            break;
+
+        case 11:
+            benchmarkBulkLoad(1000000);
+            break;
+
+        case 12:
+            benchmarkConcurrentIndex(1000000);
+            break;
+
+        case 13:
+            findBidsByPrefix(bst, bidIds);
+            break;
+
+        case 14:
+            benchmarkPrefixIndex(1000000);
+            break;
+
+        case 15:
+            benchmarkSnapshots(1000000);
             break;
         }
     }
 
+    delete bst;
+
     cout << "Good bye." << endl;
 
 	return 0;
@@ -6,13 +6,28 @@
 //                   information so advisors can help students.
 //============================================================================
 
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdint>
 #include <iostream>
 #include <time.h>
 #include <vector>
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <sstream>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PROJECT2_SSE2 1
+#define PREFETCH(address) _mm_prefetch((const char*) (address), _MM_HINT_T0)
+#elif defined(__GNUC__)
+#define PREFETCH(address) __builtin_prefetch(address)
+#else
+#define PREFETCH(address)
+#endif
+
 using namespace std;
 
 //============================================================================
@@ -21,6 +36,7 @@ using namespace std;
 
 // forward declarations
 double strToDouble(string str, char ch);
+uint64_t prefixOf(string_view key);
 
 // define a structure to hold bid information
 struct Course {
@@ -33,22 +49,27 @@ struct Course {
     }
 };
 
-// Internal structure for tree node
+// no child, slot 0 of the tree's arena stands in for every empty subtree
+const uint32_t NIL = 0;
+
+// Internal structure for tree node. Nodes sit side by side in the
+// tree's arena and link to each other by index, the course is kept out
+// of line at the same index. The first 8 bytes of the course number are
+// copied into the node, so comparisons rarely touch the course.
 struct Node {
-    Course course;
-    Node *left;
-    Node *right;
+    uint64_t prefix; // first 8 bytes of the course number, see prefixOf
+    uint32_t left;
+    uint32_t right;
+    uint32_t size; // courses in this subtree
+    int32_t height; // levels in this subtree, only kept up to date when balanced
 
     // default constructor
     Node() {
-        left = nullptr;
-        right = nullptr;
-    }
-
-    // initialize with a bid
-    Node(Course aCourse) :
-            Node() {
-        course = aCourse;
+        prefix = 0;
+        left = NIL;
+        right = NIL;
+        height = 1;
+        size = 1;
     }
 };
 
@@ -63,126 +84,496 @@ struct Node {
 class BinarySearchTree {
 
 private:
-    Node* root;
-    void inOrder(Node* node);
+    vector<Node> nodes; // the arena, slot NIL has size and height 0
+    vector<Course> nodeCourses; // course of each node, at the node's index
+    uint32_t root;
+    bool balanced;
+    uint32_t allocate(Course course);
+    int compareKey(uint32_t node, string_view key, uint64_t prefix);
+    void inOrder(uint32_t node);
+    void freeNodes();
+    uint32_t build(vector<Course>& courses, size_t low, size_t high);
+    int height(uint32_t node);
+    unsigned int size(uint32_t node);
+    void updateNode(uint32_t node);
+    vector<Course> collect(vector<uint32_t>& stack, unsigned int pageSize);
+    uint32_t rotateLeft(uint32_t node);
+    uint32_t rotateRight(uint32_t node);
+    uint32_t rebalance(uint32_t node);
 
 public:
-    BinarySearchTree();
+    BinarySearchTree(bool balanced = false);
     virtual ~BinarySearchTree();
     void InOrder();
     void Insert(Course course);
+    void BulkLoad(vector<Course> courses);
+    const Course* Find(string_view courseNum);
     Course Search(string courseNum);
+    vector<Course> Page(string afterNum, unsigned int pageSize);
+    vector<Course> PageAt(unsigned int pageNumber, unsigned int pageSize);
+    unsigned int Size();
+    unsigned int Rank(string courseNum);
+    unsigned int CountRange(string lowNum, string highNum);
 };
 
+/**
+ * Pack the first 8 bytes of a course number into an integer that orders
+ * the same way the strings do
+ */
+uint64_t prefixOf(string_view key) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < 8; i++) {
+        prefix = (prefix << 8) | (i < key.size() ? (unsigned char) key[i] : 0);
+    }
+    return prefix;
+}
+
 /**
  * Default constructor
+ *
+ * @param balanced Keep the tree AVL balanced so its height stays
+ *                 O(log n) even though course files are sorted
  */
-BinarySearchTree::BinarySearchTree() {
-    // Root is equal to nullptr
-    root = nullptr;
+BinarySearchTree::BinarySearchTree(bool balanced) {
+    // slot NIL is the empty subtree every missing child points at
+    nodes.resize(1);
+    nodes[NIL].size = 0;
+    nodes[NIL].height = 0;
+    nodeCourses.resize(1);
+    // Root is equal to NIL
+    root = NIL;
+    this->balanced = balanced;
 }
 
 /**
- * Destructor
+ * Destructor, the arena goes in one piece
  */
 BinarySearchTree::~BinarySearchTree() {
-    // Recurse from root deleting every node
-    delete root->left;
-    delete root->right;
+}
+
+/**
+ * Empty the tree. Nodes hold no pointers, so the arena is cut back to
+ * slot NIL at once instead of visiting every node.
+ */
+void BinarySearchTree::freeNodes() {
+    nodes.resize(1);
+    nodeCourses.resize(1);
+    root = NIL;
+}
+
+/**
+ * Put a course in a new leaf at the end of the arena
+ *
+ * @return Index of the node
+ */
+uint32_t BinarySearchTree::allocate(Course course) {
+    uint32_t node = (uint32_t) nodes.size();
+    nodes.push_back(Node());
+    nodes[node].prefix = prefixOf(course.courseNum);
+    nodeCourses.push_back(std::move(course));
+    return node;
+}
+
+/**
+ * Compare a node's course number with a key, reading the course only
+ * when the first 8 bytes tie
+ *
+ * @param prefix prefixOf(key)
+ * @return Less than, equal to or greater than 0 as the node's number
+ *         is less than, equal to or greater than key
+ */
+int BinarySearchTree::compareKey(uint32_t node, string_view key, uint64_t prefix) {
+    if (nodes[node].prefix != prefix) {
+        return nodes[node].prefix < prefix ? -1 : 1;
+    }
+    return nodeCourses[node].courseNum.compare(key);
+}
+
+/**
+ * Returns the height of a subtree, 0 for an empty one
+ */
+int BinarySearchTree::height(uint32_t node) {
+    return nodes[node].height;
+}
+
+/**
+ * Returns the number of courses in a subtree, 0 for an empty one
+ */
+unsigned int BinarySearchTree::size(uint32_t node) {
+    return nodes[node].size;
+}
+
+/**
+ * Recompute a node's height and subtree size from its children
+ */
+void BinarySearchTree::updateNode(uint32_t node) {
+    Node& current = nodes[node];
+    current.height = 1 + max(height(current.left), height(current.right));
+    current.size = 1 + size(current.left) + size(current.right);
+}
+
+/**
+ * Rotate a subtree left, its right child becomes the new top
+ */
+uint32_t BinarySearchTree::rotateLeft(uint32_t node) {
+    uint32_t top = nodes[node].right;
+    nodes[node].right = nodes[top].left;
+    nodes[top].left = node;
+    updateNode(node);
+    updateNode(top);
+    return top;
+}
+
+/**
+ * Rotate a subtree right, its left child becomes the new top
+ */
+uint32_t BinarySearchTree::rotateRight(uint32_t node) {
+    uint32_t top = nodes[node].left;
+    nodes[node].left = nodes[top].right;
+    nodes[top].right = node;
+    updateNode(node);
+    updateNode(top);
+    return top;
+}
+
+/**
+ * Restore the AVL property at a node after an insert below it
+ *
+ * @return The new top of the subtree
+ */
+uint32_t BinarySearchTree::rebalance(uint32_t node) {
+    updateNode(node);
+    Node& current = nodes[node];
+    int balance = height(current.left) - height(current.right);
+
+    // left heavy, a left-right shape needs its child turned first
+    if (balance > 1) {
+        if (height(nodes[current.left].left) < height(nodes[current.left].right)) {
+            current.left = rotateLeft(current.left);
+        }
+        return rotateRight(node);
+    }
+    // right heavy, mirror image
+    if (balance < -1) {
+        if (height(nodes[current.right].right) < height(nodes[current.right].left)) {
+            current.right = rotateRight(current.right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
 }
 
 void BinarySearchTree::Insert(Course course) {
     // Create new node with its course as the passed course
-    Node* newNode = new Node;
-    newNode->course = course;
+    uint32_t newNode = allocate(std::move(course));
+    const string& courseNum = nodeCourses[newNode].courseNum;
+    uint64_t prefix = nodes[newNode].prefix;
 
-    // if root equarl to null ptr
-    if (root == nullptr) {
+    // the balanced tree retraces the path back up, fixing heights and
+    // rotating where one side grew two levels taller than the other
+    if (balanced) {
+        vector<uint32_t> path;
+        for (uint32_t currNode = root; currNode != NIL;) {
+            path.push_back(currNode);
+            currNode = compareKey(currNode, courseNum, prefix) > 0 ? nodes[currNode].left : nodes[currNode].right;
+        }
+        if (path.empty()) {
+            root = newNode;
+            return;
+        }
+        if (compareKey(path.back(), courseNum, prefix) > 0) {
+            nodes[path.back()].left = newNode;
+        } else {
+            nodes[path.back()].right = newNode;
+        }
+        for (size_t i = path.size(); i-- > 0;) {
+            uint32_t top = rebalance(path[i]);
+            if (i == 0) {
+                root = top;
+            } else if (nodes[path[i - 1]].left == path[i]) {
+                nodes[path[i - 1]].left = top;
+            } else {
+                nodes[path[i - 1]].right = top;
+            }
+        }
+        return;
+    }
+
+    // if root equarl to NIL
+    if (root == NIL) {
         // root is equal to new node course
         root = newNode;
-        newNode->left = nullptr;
-        newNode->right = nullptr;
     }
     else {
         // Create new node equal to root node
-        Node* currNode = root;
+        uint32_t currNode = root;
 
         // Continue looping through tree until a proper spot has been found for the new node
-        while (currNode != nullptr) {
+        while (currNode != NIL) {
+            Node& current = nodes[currNode];
+            // the new node ends up somewhere below this one
+            current.size++;
             // LEFT branch
-            if (newNode->course.courseNum < currNode->course.courseNum) {
+            if (compareKey(currNode, courseNum, prefix) > 0) {
                 // IF no left node set it to the new node
-                if (currNode->left == nullptr) {
-                    currNode->left = newNode;
-                    currNode = nullptr;
+                if (current.left == NIL) {
+                    current.left = newNode;
+                    currNode = NIL;
                 }
                 // Set currNode to the new left node
                 else {
-                    currNode = currNode->left;
+                    currNode = current.left;
                 }
             }
             // RIGHT branch
             else {
                 // IF no right node set it to the new node
-                if (currNode->right == nullptr) {
-                    currNode->right = newNode;
-                    currNode = nullptr;
+                if (current.right == NIL) {
+                    current.right = newNode;
+                    currNode = NIL;
                 }
                 // Set currNode to the new right node
                 else {
-                    currNode = currNode->right;
+                    currNode = current.right;
                 }
             }
-            // Once a spot has been found for the new node, set its left & right nodes to nullptr as the newNode is a leaf node
-            newNode->left = nullptr;
-            newNode->right = nullptr;
         }
     }
 }
 
+/**
+ * Load many courses at once. Course files are usually sorted already,
+ * which is detected so they are not sorted again. Courses already in
+ * the tree are merged in and the tree is rebuilt perfectly balanced in
+ * O(n), where inserting a sorted file one course at a time into a plain
+ * tree costs O(n^2).
+ *
+ * @param courses The courses to add
+ */
+void BinarySearchTree::BulkLoad(vector<Course> courses) {
+    auto byNum = [](const Course& a, const Course& b) {
+        return a.courseNum < b.courseNum;
+    };
+    if (!is_sorted(courses.begin(), courses.end(), byNum)) {
+        stable_sort(courses.begin(), courses.end(), byNum);
+    }
+
+    // the tree's own courses come out in order, so merging keeps it linear
+    if (root != NIL) {
+        vector<Course> current = Page("", UINT_MAX);
+        vector<Course> merged;
+        merged.reserve(current.size() + courses.size());
+        merge(current.begin(), current.end(), courses.begin(), courses.end(), back_inserter(merged), byNum);
+        courses.swap(merged);
+    }
+
+    // start over with an arena exactly the size of the new tree
+    freeNodes();
+    nodes.reserve(courses.size() + 1);
+    nodeCourses.reserve(courses.size() + 1);
+    root = build(courses, 0, courses.size());
+}
+
+/**
+ * Build a perfectly balanced subtree from sorted courses, the middle
+ * course becomes the top
+ *
+ * @return Top of the subtree, NIL if it is empty
+ */
+uint32_t BinarySearchTree::build(vector<Course>& courses, size_t low, size_t high) {
+    if (low >= high) {
+        return NIL;
+    }
+    // a parent lands in the arena just before its left subtree
+    size_t middle = low + (high - low) / 2;
+    uint32_t node = allocate(std::move(courses[middle]));
+    uint32_t left = build(courses, low, middle);
+    uint32_t right = build(courses, middle + 1, high);
+    nodes[node].left = left;
+    nodes[node].right = right;
+    updateNode(node);
+    return node;
+}
+
 void BinarySearchTree::InOrder() {
     this->inOrder(root);
 }
 
 /**
- * Search for a bid
+ * Find a course without copying it
+ *
+ * @param courseNum The course number to look for
+ * @return The course in the tree, nullptr if not found. It stays valid
+ *         until the next insert, which may move the arena.
  */
-Course BinarySearchTree::Search(string courseNum) {
+const Course* BinarySearchTree::Find(string_view courseNum) {
     // set current node equal to root
-    Node* currNode = root;
+    uint64_t prefix = prefixOf(courseNum);
+    uint32_t currNode = root;
 
     // keep looping downwards until bottom reached or matching courseNum found
-    while (currNode != nullptr) {
+    while (currNode != NIL) {
+        int order = compareKey(currNode, courseNum, prefix);
         // if match found, return current course
-        if (currNode->course.courseNum == courseNum) {
-            return currNode->course;
+        if (order == 0) {
+            return &nodeCourses[currNode];
         }
         // if courseNum is smaller than current node then traverse left
-        else if (courseNum < currNode->course.courseNum) {
-            currNode = currNode->left;
+        else if (order > 0) {
+            currNode = nodes[currNode].left;
         }
         // else larger so traverse right
         else {
-            currNode = currNode->right;
+            currNode = nodes[currNode].right;
         }
     }
+    // Course not found
+    return nullptr;
+}
+
+/**
+ * Search for a bid
+ */
+Course BinarySearchTree::Search(string courseNum) {
+    const Course* found = Find(courseNum);
+    if (found != nullptr) {
+        return *found;
+    }
     // Course not found, return empty course
     Course course;
     return course;
 }
 
-void BinarySearchTree::inOrder(Node* node) {
-    //if node is not equal to null ptr
-    if (node == nullptr) {
-        return;
+/**
+ * Collect one page of courses in order of course number. Pass the last
+ * course number of the previous page to get the next one, or an empty
+ * string for the first. Walks with an explicit stack, so a page of k
+ * courses costs O(log n + k).
+ *
+ * @param afterNum The last course number already shown
+ * @param pageSize The most courses to return
+ * @return The page, shorter than pageSize on the last page
+ */
+vector<Course> BinarySearchTree::Page(string afterNum, unsigned int pageSize) {
+    // stack the nodes after afterNum where the walk turns left, the top
+    // is the first course of the page
+    uint64_t prefix = prefixOf(afterNum);
+    vector<uint32_t> stack;
+    uint32_t node = root;
+    while (node != NIL) {
+        if (!afterNum.empty() && compareKey(node, afterNum, prefix) <= 0) {
+            node = nodes[node].right;
+        } else {
+            stack.push_back(node);
+            node = nodes[node].left;
+        }
+    }
+    return collect(stack, pageSize);
+}
+
+/**
+ * Collect a numbered page of courses in order of course number. The
+ * subtree sizes lead straight to the first course of the page, so the
+ * last page costs the same O(log n + k) as the first.
+ *
+ * @param pageNumber Page to return, 0 for the first
+ * @param pageSize The most courses to return
+ * @return The page, shorter than pageSize on the last page
+ */
+vector<Course> BinarySearchTree::PageAt(unsigned int pageNumber, unsigned int pageSize) {
+    // as in Page, stack the nodes where the walk turns left
+    unsigned int position = pageNumber * pageSize;
+    vector<uint32_t> stack;
+    uint32_t node = root;
+    while (node != NIL) {
+        unsigned int leftSize = size(nodes[node].left);
+        if (position < leftSize) {
+            stack.push_back(node);
+            node = nodes[node].left;
+        } else if (position == leftSize) {
+            stack.push_back(node);
+            break;
+        } else {
+            position -= leftSize + 1;
+            node = nodes[node].right;
+        }
+    }
+    return collect(stack, pageSize);
+}
+
+/**
+ * Pop up to pageSize courses in order off a stack of nodes still to visit
+ */
+vector<Course> BinarySearchTree::collect(vector<uint32_t>& stack, unsigned int pageSize) {
+    vector<Course> courses;
+    while (!stack.empty() && courses.size() < pageSize) {
+        uint32_t node = stack.back();
+        stack.pop_back();
+        courses.push_back(nodeCourses[node]);
+        // next comes the leftmost course of the right subtree
+        for (node = nodes[node].right; node != NIL; node = nodes[node].left) {
+            stack.push_back(node);
+        }
+    }
+    return courses;
+}
+
+/**
+ * Returns the number of courses in the tree
+ */
+unsigned int BinarySearchTree::Size() {
+    return size(root);
+}
+
+/**
+ * Returns the number of courses numbered before courseNum, which is
+ * also the position it has or would have in the course list
+ */
+unsigned int BinarySearchTree::Rank(string courseNum) {
+    uint64_t prefix = prefixOf(courseNum);
+    unsigned int count = 0;
+    uint32_t node = root;
+    while (node != NIL) {
+        if (compareKey(node, courseNum, prefix) < 0) {
+            count += size(nodes[node].left) + 1;
+            node = nodes[node].right;
+        } else {
+            node = nodes[node].left;
+        }
     }
+    return count;
+}
 
-    //InOrder left
-    inOrder(node->left);
-    //output courseNum, title
-    cout << node->course.courseNum << ", " << node->course.title << endl;
-    //InOder right
-    inOrder(node->right);
+/**
+ * Returns the number of courses numbered from lowNum to highNum, both included
+ */
+unsigned int BinarySearchTree::CountRange(string lowNum, string highNum) {
+    if (highNum < lowNum) {
+        return 0;
+    }
+    // the courses up to highNum are the ones before the next possible number
+    return Rank(highNum + '\0') - Rank(lowNum);
+}
+
+/**
+ * Print a subtree in order with an explicit stack, so a tree as deep
+ * as it has courses cannot overflow the call stack
+ */
+void BinarySearchTree::inOrder(uint32_t node) {
+    vector<uint32_t> stack;
+    while (node != NIL || !stack.empty()) {
+        //InOrder left
+        while (node != NIL) {
+            stack.push_back(node);
+            node = nodes[node].left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        //output courseNum, title
+        cout << nodeCourses[node].courseNum << ", " << nodeCourses[node].title << endl;
+        //InOder right
+        node = nodes[node].right;
+    }
 }
 
 void loadCourses(string filePath, BinarySearchTree* bst) {
@@ -204,6 +595,7 @@ void loadCourses(string filePath, BinarySearchTree* bst) {
     // POSSIBLE PROBLEM: Microsoft Text file encoding can cause a problem if it is UTF-8 BOM
     // FIX: Save text file as the same file but change the encoding to the normal UTF-8
     // Loop over each line in file until '\n' or eof is found
+    vector<Course> courses;
     while (!fs.eof()) {
         // Declare variable to hold each line, the splitLine, the the vector representing the splitLine
         string line;
@@ -233,11 +625,917 @@ void loadCourses(string filePath, BinarySearchTree* bst) {
         {
             course.prereqs.push_back(lineVec.at(i));
         }
-        bst->Insert(course);
+        courses.push_back(course);
     }
+
+    // Build the tree in one pass instead of one insert per course
+    bst->BulkLoad(std::move(courses));
     cout << "File loaded." << endl;
 }
 
+//============================================================================
+// Course Index class definition
+//============================================================================
+
+/**
+ * Read-only index of a loaded catalog. The sorted course numbers are
+ * laid out in Eytzinger (breadth first) order in one array, so the
+ * children of slot k are slots 2k and 2k + 1 and a search walks down
+ * the array without chasing pointers. The first 8 bytes of every course
+ * number are packed into an integer for cheap comparisons, and the
+ * courses themselves sit in a parallel array touched only on a match.
+ */
+class CourseIndex {
+
+private:
+    // slot 0 is unused so the arithmetic stays simple
+    vector<uint64_t> prefixes;
+    vector<string> keys;
+    vector<Course> courses;
+
+    size_t first();
+    size_t next(size_t slot);
+
+public:
+    void Build(BinarySearchTree* bst);
+    const Course* Find(string_view courseNum);
+    Course Search(string courseNum);
+    vector<Course> Export();
+    vector<const Course*> Courses();
+    size_t Size();
+};
+
+/**
+ * Returns the slot of the smallest course number, the leftmost one
+ */
+size_t CourseIndex::first() {
+    size_t slot = 1;
+    while (slot * 2 < keys.size()) {
+        slot *= 2;
+    }
+    return slot;
+}
+
+/**
+ * Returns the slot after the given one in sorted order, 0 past the end
+ */
+size_t CourseIndex::next(size_t slot) {
+    // leftmost slot of the right subtree
+    if (slot * 2 + 1 < keys.size()) {
+        slot = slot * 2 + 1;
+        while (slot * 2 < keys.size()) {
+            slot *= 2;
+        }
+        return slot;
+    }
+    // else climb while coming from a right child, then once more
+    while (slot & 1) {
+        slot >>= 1;
+    }
+    return slot >> 1;
+}
+
+/**
+ * Freeze the courses of a tree into the index, replacing what it held
+ *
+ * @param bst The tree to copy the courses from
+ */
+void CourseIndex::Build(BinarySearchTree* bst) {
+    vector<Course> sorted = bst->Page("", UINT_MAX);
+    prefixes.assign(sorted.size() + 1, 0);
+    keys.assign(sorted.size() + 1, "");
+    courses.assign(sorted.size() + 1, Course());
+
+    // visiting the slots in sorted order hands out the sorted courses
+    size_t slot = first();
+    for (Course& course : sorted) {
+        prefixes[slot] = prefixOf(course.courseNum);
+        keys[slot] = course.courseNum;
+        courses[slot] = std::move(course);
+        slot = next(slot);
+    }
+}
+
+/**
+ * Find a course without copying it
+ *
+ * @param courseNum The course number to look for
+ * @return The course in the index, nullptr if not found. It stays valid
+ *         until the index is rebuilt.
+ */
+const Course* CourseIndex::Find(string_view courseNum) {
+    uint64_t prefix = prefixOf(courseNum);
+    size_t count = keys.size();
+    size_t slot = 1;
+    while (slot < count) {
+        // the 8 slots three levels down share one cache line, start loading it
+        size_t ahead = slot * 8;
+        PREFETCH(prefixes.data() + (ahead < count ? ahead : 0));
+        // full strings are only compared when the prefixes tie
+        bool right = prefixes[slot] < prefix || (prefixes[slot] == prefix && keys[slot] < courseNum);
+        slot = slot * 2 + right;
+    }
+
+    // drop the trailing right turns and the last left turn, leaving the
+    // slot of the smallest course number not less than courseNum
+    while (slot & 1) {
+        slot >>= 1;
+    }
+    slot >>= 1;
+    if (slot != 0 && keys[slot] == courseNum) {
+        return &courses[slot];
+    }
+    return nullptr;
+}
+
+/**
+ * Search for a course
+ *
+ * @param courseNum The course number to look for
+ * @return A copy of the course, empty if it is not in the index
+ */
+Course CourseIndex::Search(string courseNum) {
+    const Course* found = Find(courseNum);
+    if (found != nullptr) {
+        return *found;
+    }
+    Course course;
+    return course;
+}
+
+/**
+ * Returns every course in order of course number
+ */
+vector<Course> CourseIndex::Export() {
+    vector<Course> sorted;
+    if (keys.size() > 1) {
+        for (size_t slot = first(); slot != 0; slot = next(slot)) {
+            sorted.push_back(courses[slot]);
+        }
+    }
+    return sorted;
+}
+
+/**
+ * Returns every course in order of course number without copying them,
+ * the pointers stay valid until the index is rebuilt
+ */
+vector<const Course*> CourseIndex::Courses() {
+    vector<const Course*> sorted;
+    if (keys.size() > 1) {
+        for (size_t slot = first(); slot != 0; slot = next(slot)) {
+            sorted.push_back(&courses[slot]);
+        }
+    }
+    return sorted;
+}
+
+/**
+ * Returns the number of courses in the index
+ */
+size_t CourseIndex::Size() {
+    return keys.size() - (keys.empty() ? 0 : 1);
+}
+
+//============================================================================
+// Adaptive Radix Tree class definition
+//============================================================================
+
+// kinds of radix tree node, inner nodes are named for the children they hold
+enum RadixKind : uint8_t {
+    RADIX_LEAF, RADIX_NODE4, RADIX_NODE16, RADIX_NODE48, RADIX_NODE256
+};
+
+/**
+ * Define a class implementing an adaptive radix tree over string keys,
+ * used to find the courses whose numbers start with what an advisor types.
+ * Each inner node branches on one byte of the key and is only as big as
+ * its children need: up to 4 or 16 in sorted arrays, up to 48 behind a
+ * 256 byte index, or a full 256 way array. Bytes every key below a node
+ * shares are kept once in the node as a compressed prefix. A lookup or
+ * a prefix query walks at most one node per key byte, however many keys
+ * there are, and a prefix's keys are visited in sorted order, so a
+ * query costs O(prefix length + matches).
+ */
+template<class Value>
+class RadixTree {
+
+private:
+    struct Node {
+        RadixKind kind;
+
+        Node(RadixKind aKind) : kind(aKind) {
+        }
+    };
+
+    struct Leaf : Node {
+        string key;
+        Value value;
+
+        Leaf(const string& aKey, Value aValue) : Node(RADIX_LEAF), key(aKey), value(std::move(aValue)) {
+        }
+    };
+
+    // the bytes in prefix come next in every key below, then one byte picks the child
+    struct Inner : Node {
+        unsigned int count = 0;
+        string prefix;
+        Leaf* ends = nullptr; // the key that ends right after prefix
+
+        Inner(RadixKind aKind) : Node(aKind) {
+        }
+    };
+
+    // keys kept sorted, children[i] is under keys[i]
+    struct Node4 : Inner {
+        uint8_t keys[4];
+        Node* children[4];
+
+        Node4() : Inner(RADIX_NODE4) {
+        }
+    };
+
+    struct Node16 : Inner {
+        uint8_t keys[16];
+        Node* children[16];
+
+        Node16() : Inner(RADIX_NODE16) {
+        }
+    };
+
+    // index[byte] is the child's slot plus one, 0 for none
+    struct Node48 : Inner {
+        uint8_t index[256];
+        Node* children[48];
+
+        Node48() : Inner(RADIX_NODE48) {
+            fill(index, index + 256, 0);
+        }
+    };
+
+    struct Node256 : Inner {
+        Node* children[256];
+
+        Node256() : Inner(RADIX_NODE256) {
+            fill(children, children + 256, nullptr);
+        }
+    };
+
+    Node* root;
+    size_t size;
+
+    static Inner* newInner(RadixKind kind);
+    static void destroy(Node* node);
+    static void freeShell(Inner* node);
+    static size_t bytesUsed(Node* node);
+    static Node** findChild(Inner* node, uint8_t byte);
+    static void insertChild(Inner* node, uint8_t byte, Node* child);
+    static void eraseChild(Inner* node, uint8_t byte);
+    static void placeLeaf(Inner* node, Leaf* leaf, size_t depth);
+    static void addChild(Node** ref, uint8_t byte, Node* child);
+    static void removeChild(Node** ref, uint8_t byte);
+    static void collapse(Node** ref);
+    static void resize(Node** ref, RadixKind kind);
+    template<class Visit> static void forEachChild(Inner* node, Visit visit);
+    static bool collect(Node* node, vector<Value>& results, size_t limit);
+
+public:
+    RadixTree();
+    RadixTree(const RadixTree&) = delete;
+    RadixTree& operator=(const RadixTree&) = delete;
+    virtual ~RadixTree();
+    bool Insert(const string& key, Value value);
+    bool Remove(const string& key);
+    const Value* Search(string_view key) const;
+    vector<Value> WithPrefix(const string& prefix, size_t limit = SIZE_MAX) const;
+    void Clear();
+    size_t Size() const;
+    size_t MemoryBytes() const;
+};
+
+/**
+ * Default constructor
+ */
+template<class Value>
+RadixTree<Value>::RadixTree() {
+    root = nullptr;
+    size = 0;
+}
+
+/**
+ * Destructor
+ */
+template<class Value>
+RadixTree<Value>::~RadixTree() {
+    destroy(root);
+}
+
+/**
+ * Make an empty inner node of a kind
+ */
+template<class Value>
+typename RadixTree<Value>::Inner* RadixTree<Value>::newInner(RadixKind kind) {
+    switch (kind) {
+    case RADIX_NODE4:
+        return new Node4();
+    case RADIX_NODE16:
+        return new Node16();
+    case RADIX_NODE48:
+        return new Node48();
+    default:
+        return new Node256();
+    }
+}
+
+/**
+ * Free a subtree. Recursion is only as deep as the longest key.
+ */
+template<class Value>
+void RadixTree<Value>::destroy(Node* node) {
+    if (node == nullptr) {
+        return;
+    }
+    if (node->kind == RADIX_LEAF) {
+        delete (Leaf*) node;
+        return;
+    }
+    Inner* inner = (Inner*) node;
+    forEachChild(inner, [](uint8_t, Node* child) {
+        destroy(child);
+    });
+    destroy(inner->ends);
+    freeShell(inner);
+}
+
+/**
+ * Free an inner node alone, its children and ends belong elsewhere now
+ */
+template<class Value>
+void RadixTree<Value>::freeShell(Inner* node) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+        delete (Node4*) node;
+        break;
+    case RADIX_NODE16:
+        delete (Node16*) node;
+        break;
+    case RADIX_NODE48:
+        delete (Node48*) node;
+        break;
+    default:
+        delete (Node256*) node;
+    }
+}
+
+/**
+ * Returns the bytes taken by the nodes of a subtree and their strings,
+ * not counting memory the values point to
+ */
+template<class Value>
+size_t RadixTree<Value>::bytesUsed(Node* node) {
+    if (node == nullptr) {
+        return 0;
+    }
+    if (node->kind == RADIX_LEAF) {
+        Leaf* leaf = (Leaf*) node;
+        return sizeof(Leaf) + (leaf->key.capacity() > 15 ? leaf->key.capacity() + 1 : 0);
+    }
+    Inner* inner = (Inner*) node;
+    size_t bytes = inner->prefix.capacity() > 15 ? inner->prefix.capacity() + 1 : 0;
+    switch (inner->kind) {
+    case RADIX_NODE4:
+        bytes += sizeof(Node4);
+        break;
+    case RADIX_NODE16:
+        bytes += sizeof(Node16);
+        break;
+    case RADIX_NODE48:
+        bytes += sizeof(Node48);
+        break;
+    default:
+        bytes += sizeof(Node256);
+    }
+    forEachChild(inner, [&bytes](uint8_t, Node* child) {
+        bytes += bytesUsed(child);
+    });
+    return bytes + bytesUsed(inner->ends);
+}
+
+/**
+ * Find the child under a byte
+ *
+ * @return Where the child pointer is kept, nullptr if there is no child
+ */
+template<class Value>
+typename RadixTree<Value>::Node** RadixTree<Value>::findChild(Inner* node, uint8_t byte) {
+    switch (node->kind) {
+    case RADIX_NODE4: {
+        Node4* node4 = (Node4*) node;
+        for (unsigned int i = 0; i < node4->count; i++) {
+            if (node4->keys[i] == byte) {
+                return &node4->children[i];
+            }
+        }
+        return nullptr;
+    }
+    case RADIX_NODE16: {
+        // all 16 keys compared at once, the bits past count are dropped
+        Node16* node16 = (Node16*) node;
+#ifdef PROJECT2_SSE2
+        __m128i keys = _mm_loadu_si128((const __m128i*) node16->keys);
+        unsigned int matches = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(keys, _mm_set1_epi8((char) byte)));
+        matches &= (1u << node16->count) - 1;
+        for (unsigned int i = 0; matches != 0; i++, matches >>= 1) {
+            if (matches & 1u) {
+                return &node16->children[i];
+            }
+        }
+#else
+        for (unsigned int i = 0; i < node16->count; i++) {
+            if (node16->keys[i] == byte) {
+                return &node16->children[i];
+            }
+        }
+#endif
+        return nullptr;
+    }
+    case RADIX_NODE48: {
+        Node48* node48 = (Node48*) node;
+        return node48->index[byte] == 0 ? nullptr : &node48->children[node48->index[byte] - 1];
+    }
+    default: {
+        Node256* node256 = (Node256*) node;
+        return node256->children[byte] == nullptr ? nullptr : &node256->children[byte];
+    }
+    }
+}
+
+/**
+ * Add a child under a byte the node has no child for, the node has room
+ */
+template<class Value>
+void RadixTree<Value>::insertChild(Inner* node, uint8_t byte, Node* child) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+    case RADIX_NODE16: {
+        // both keep their keys sorted, they differ only in length
+        uint8_t* keys = node->kind == RADIX_NODE4 ? ((Node4*) node)->keys : ((Node16*) node)->keys;
+        Node** children = node->kind == RADIX_NODE4 ? ((Node4*) node)->children : ((Node16*) node)->children;
+        unsigned int pos = node->count;
+        while (pos > 0 && keys[pos - 1] > byte) {
+            keys[pos] = keys[pos - 1];
+            children[pos] = children[pos - 1];
+            pos--;
+        }
+        keys[pos] = byte;
+        children[pos] = child;
+        break;
+    }
+    case RADIX_NODE48: {
+        // slots are packed, removal moves the last one into the gap
+        Node48* node48 = (Node48*) node;
+        node48->children[node->count] = child;
+        node48->index[byte] = (uint8_t) (node->count + 1);
+        break;
+    }
+    default:
+        ((Node256*) node)->children[byte] = child;
+    }
+    node->count++;
+}
+
+/**
+ * Drop the child under a byte, the caller frees it or moves it elsewhere
+ */
+template<class Value>
+void RadixTree<Value>::eraseChild(Inner* node, uint8_t byte) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+    case RADIX_NODE16: {
+        uint8_t* keys = node->kind == RADIX_NODE4 ? ((Node4*) node)->keys : ((Node16*) node)->keys;
+        Node** children = node->kind == RADIX_NODE4 ? ((Node4*) node)->children : ((Node16*) node)->children;
+        unsigned int pos = 0;
+        while (keys[pos] != byte) {
+            pos++;
+        }
+        for (; pos + 1 < node->count; pos++) {
+            keys[pos] = keys[pos + 1];
+            children[pos] = children[pos + 1];
+        }
+        break;
+    }
+    case RADIX_NODE48: {
+        Node48* node48 = (Node48*) node;
+        unsigned int slot = node48->index[byte] - 1;
+        unsigned int last = node->count - 1;
+        if (slot != last) {
+            // find the byte of the last slot to point it at the gap
+            for (unsigned int other = 0; other < 256; other++) {
+                if (node48->index[other] == last + 1) {
+                    node48->index[other] = (uint8_t) (slot + 1);
+                    break;
+                }
+            }
+            node48->children[slot] = node48->children[last];
+        }
+        node48->index[byte] = 0;
+        break;
+    }
+    default:
+        ((Node256*) node)->children[byte] = nullptr;
+    }
+    node->count--;
+}
+
+/**
+ * Put a leaf in a fresh node whose prefix ends at depth, under its next
+ * byte or as the key ending here
+ */
+template<class Value>
+void RadixTree<Value>::placeLeaf(Inner* node, Leaf* leaf, size_t depth) {
+    if (leaf->key.size() == depth) {
+        node->ends = leaf;
+    } else {
+        insertChild(node, (uint8_t) leaf->key[depth], leaf);
+    }
+}
+
+/**
+ * Add a child to the inner node at ref, moving it to the next bigger
+ * kind first if it is full
+ */
+template<class Value>
+void RadixTree<Value>::addChild(Node** ref, uint8_t byte, Node* child) {
+    Inner* node = (Inner*) *ref;
+    if (node->kind == RADIX_NODE4 && node->count == 4) {
+        resize(ref, RADIX_NODE16);
+    } else if (node->kind == RADIX_NODE16 && node->count == 16) {
+        resize(ref, RADIX_NODE48);
+    } else if (node->kind == RADIX_NODE48 && node->count == 48) {
+        resize(ref, RADIX_NODE256);
+    }
+    insertChild((Inner*) *ref, byte, child);
+}
+
+/**
+ * Drop a child from the inner node at ref, moving it to a smaller kind
+ * once it is well under the size it needs. The gap between growing and
+ * shrinking keeps a node from flipping back and forth.
+ */
+template<class Value>
+void RadixTree<Value>::removeChild(Node** ref, uint8_t byte) {
+    Inner* node = (Inner*) *ref;
+    eraseChild(node, byte);
+    if (node->kind == RADIX_NODE256 && node->count <= 36) {
+        resize(ref, RADIX_NODE48);
+    } else if (node->kind == RADIX_NODE48 && node->count <= 12) {
+        resize(ref, RADIX_NODE16);
+    } else if (node->kind == RADIX_NODE16 && node->count <= 3) {
+        resize(ref, RADIX_NODE4);
+    }
+}
+
+/**
+ * Replace an inner node left with a single way on: a lone key ending
+ * here becomes a leaf, a lone child takes the node's prefix and byte
+ */
+template<class Value>
+void RadixTree<Value>::collapse(Node** ref) {
+    Inner* node = (Inner*) *ref;
+    if (node->count == 0) {
+        *ref = node->ends;
+        freeShell(node);
+    } else if (node->count == 1 && node->ends == nullptr) {
+        uint8_t byte = 0;
+        Node* child = nullptr;
+        forEachChild(node, [&byte, &child](uint8_t childByte, Node* only) {
+            byte = childByte;
+            child = only;
+        });
+        if (child->kind != RADIX_LEAF) {
+            Inner* inner = (Inner*) child;
+            inner->prefix = node->prefix + (char) byte + inner->prefix;
+        }
+        *ref = child;
+        freeShell(node);
+    }
+}
+
+/**
+ * Move the inner node at ref into a new node of another kind
+ */
+template<class Value>
+void RadixTree<Value>::resize(Node** ref, RadixKind kind) {
+    Inner* node = (Inner*) *ref;
+    Inner* resized = newInner(kind);
+    resized->prefix = std::move(node->prefix);
+    resized->ends = node->ends;
+    forEachChild(node, [resized](uint8_t byte, Node* child) {
+        insertChild(resized, byte, child);
+    });
+    freeShell(node);
+    *ref = resized;
+}
+
+/**
+ * Pass each child of an inner node to visit(byte, child), in byte order
+ */
+template<class Value>
+template<class Visit>
+void RadixTree<Value>::forEachChild(Inner* node, Visit visit) {
+    switch (node->kind) {
+    case RADIX_NODE4:
+        for (unsigned int i = 0; i < node->count; i++) {
+            visit(((Node4*) node)->keys[i], ((Node4*) node)->children[i]);
+        }
+        break;
+    case RADIX_NODE16:
+        for (unsigned int i = 0; i < node->count; i++) {
+            visit(((Node16*) node)->keys[i], ((Node16*) node)->children[i]);
+        }
+        break;
+    case RADIX_NODE48: {
+        Node48* node48 = (Node48*) node;
+        for (unsigned int byte = 0; byte < 256; byte++) {
+            if (node48->index[byte] != 0) {
+                visit((uint8_t) byte, node48->children[node48->index[byte] - 1]);
+            }
+        }
+        break;
+    }
+    default:
+        for (unsigned int byte = 0; byte < 256; byte++) {
+            if (((Node256*) node)->children[byte] != nullptr) {
+                visit((uint8_t) byte, ((Node256*) node)->children[byte]);
+            }
+        }
+    }
+}
+
+/**
+ * Append the values of a subtree in key order, a key ending at a node
+ * sorts before the longer keys under it
+ *
+ * @return false once limit values have been collected
+ */
+template<class Value>
+bool RadixTree<Value>::collect(Node* node, vector<Value>& results, size_t limit) {
+    if (results.size() >= limit) {
+        return false;
+    }
+    if (node->kind == RADIX_LEAF) {
+        results.push_back(((Leaf*) node)->value);
+        return results.size() < limit;
+    }
+    Inner* inner = (Inner*) node;
+    if (inner->ends != nullptr && !collect(inner->ends, results, limit)) {
+        return false;
+    }
+    bool more = true;
+    forEachChild(inner, [&](uint8_t, Node* child) {
+        more = more && collect(child, results, limit);
+    });
+    return more;
+}
+
+/**
+ * Insert a value, replacing the value already under the key if any
+ *
+ * @return true if the key is new
+ */
+template<class Value>
+bool RadixTree<Value>::Insert(const string& key, Value value) {
+    Node** ref = &root;
+    size_t depth = 0;
+    while (true) {
+        Node* node = *ref;
+        if (node == nullptr) {
+            *ref = new Leaf(key, std::move(value));
+            size++;
+            return true;
+        }
+
+        // a leaf in the way branches where the two keys part
+        if (node->kind == RADIX_LEAF) {
+            Leaf* leaf = (Leaf*) node;
+            if (leaf->key == key) {
+                leaf->value = std::move(value);
+                return false;
+            }
+            size_t common = depth;
+            while (common < key.size() && common < leaf->key.size() && key[common] == leaf->key[common]) {
+                common++;
+            }
+            Inner* branch = newInner(RADIX_NODE4);
+            branch->prefix = key.substr(depth, common - depth);
+            placeLeaf(branch, leaf, common);
+            placeLeaf(branch, new Leaf(key, std::move(value)), common);
+            *ref = branch;
+            size++;
+            return true;
+        }
+
+        // leaving the compressed prefix part way splits it there
+        Inner* inner = (Inner*) node;
+        size_t matched = 0;
+        while (matched < inner->prefix.size() && depth + matched < key.size()
+                && key[depth + matched] == inner->prefix[matched]) {
+            matched++;
+        }
+        if (matched < inner->prefix.size()) {
+            Inner* branch = newInner(RADIX_NODE4);
+            branch->prefix = inner->prefix.substr(0, matched);
+            uint8_t byte = (uint8_t) inner->prefix[matched];
+            inner->prefix.erase(0, matched + 1);
+            insertChild(branch, byte, inner);
+            placeLeaf(branch, new Leaf(key, std::move(value)), depth + matched);
+            *ref = branch;
+            size++;
+            return true;
+        }
+        depth += matched;
+
+        if (depth == key.size()) {
+            if (inner->ends != nullptr) {
+                inner->ends->value = std::move(value);
+                return false;
+            }
+            inner->ends = new Leaf(key, std::move(value));
+            size++;
+            return true;
+        }
+        Node** child = findChild(inner, (uint8_t) key[depth]);
+        if (child == nullptr) {
+            addChild(ref, (uint8_t) key[depth], new Leaf(key, std::move(value)));
+            size++;
+            return true;
+        }
+        ref = child;
+        depth++;
+    }
+}
+
+/**
+ * Remove a key, merging nodes that are left with a single way on
+ *
+ * @return true if the key was there
+ */
+template<class Value>
+bool RadixTree<Value>::Remove(const string& key) {
+    Node** parent = nullptr;
+    Node** ref = &root;
+    uint8_t byte = 0;
+    size_t depth = 0;
+    while (*ref != nullptr) {
+        Node* node = *ref;
+        if (node->kind == RADIX_LEAF) {
+            if (((Leaf*) node)->key != key) {
+                return false;
+            }
+            destroy(node);
+            size--;
+            if (parent == nullptr) {
+                root = nullptr;
+            } else {
+                removeChild(parent, byte);
+                collapse(parent);
+            }
+            return true;
+        }
+
+        Inner* inner = (Inner*) node;
+        if (key.compare(depth, inner->prefix.size(), inner->prefix) != 0) {
+            return false;
+        }
+        depth += inner->prefix.size();
+        if (depth == key.size()) {
+            if (inner->ends == nullptr) {
+                return false;
+            }
+            destroy(inner->ends);
+            inner->ends = nullptr;
+            size--;
+            collapse(ref);
+            return true;
+        }
+        Node** child = findChild(inner, (uint8_t) key[depth]);
+        if (child == nullptr) {
+            return false;
+        }
+        parent = ref;
+        byte = (uint8_t) key[depth];
+        ref = child;
+        depth++;
+    }
+    return false;
+}
+
+/**
+ * Search for the value under a key
+ *
+ * @return The value, nullptr if the key is not there
+ */
+template<class Value>
+const Value* RadixTree<Value>::Search(string_view key) const {
+    Node* node = root;
+    size_t depth = 0;
+    while (node != nullptr) {
+        // every byte on the way was matched, a leaf only checks the rest
+        if (node->kind == RADIX_LEAF) {
+            Leaf* leaf = (Leaf*) node;
+            return leaf->key == key ? &leaf->value : nullptr;
+        }
+        Inner* inner = (Inner*) node;
+        if (key.compare(depth, inner->prefix.size(), inner->prefix) != 0) {
+            return nullptr;
+        }
+        depth += inner->prefix.size();
+        if (depth == key.size()) {
+            return inner->ends != nullptr ? &inner->ends->value : nullptr;
+        }
+        Node** child = findChild(inner, (uint8_t) key[depth]);
+        if (child == nullptr) {
+            return nullptr;
+        }
+        node = *child;
+        depth++;
+    }
+    return nullptr;
+}
+
+/**
+ * Collect the values of every key starting with prefix, in key order
+ *
+ * @param prefix The start the keys share, empty for every key
+ * @param limit The most values to return
+ * @return The values, sorted by key
+ */
+template<class Value>
+vector<Value> RadixTree<Value>::WithPrefix(const string& prefix, size_t limit) const {
+    vector<Value> results;
+    Node* node = root;
+    size_t depth = 0;
+    while (node != nullptr) {
+        // the query ran out, everything below starts with it
+        if (depth == prefix.size()) {
+            collect(node, results, limit);
+            break;
+        }
+        if (node->kind == RADIX_LEAF) {
+            if (((Leaf*) node)->key.compare(0, prefix.size(), prefix) == 0) {
+                collect(node, results, limit);
+            }
+            break;
+        }
+
+        // the query may end part way through the compressed prefix
+        Inner* inner = (Inner*) node;
+        size_t length = min(inner->prefix.size(), prefix.size() - depth);
+        if (prefix.compare(depth, length, inner->prefix, 0, length) != 0) {
+            break;
+        }
+        depth += length;
+        if (depth == prefix.size()) {
+            collect(node, results, limit);
+            break;
+        }
+        Node** child = findChild(inner, (uint8_t) prefix[depth]);
+        if (child == nullptr) {
+            break;
+        }
+        node = *child;
+        depth++;
+    }
+    return results;
+}
+
+/**
+ * Remove every key
+ */
+template<class Value>
+void RadixTree<Value>::Clear() {
+    destroy(root);
+    root = nullptr;
+    size = 0;
+}
+
+/**
+ * Returns the number of keys
+ */
+template<class Value>
+size_t RadixTree<Value>::Size() const {
+    return size;
+}
+
+/**
+ * Returns the bytes taken by the tree's nodes and key strings, not
+ * counting memory the values point to
+ */
+template<class Value>
+size_t RadixTree<Value>::MemoryBytes() const {
+    return bytesUsed(root);
+}
+
 //============================================================================
 // Static methods used for testing
 //============================================================================
@@ -247,7 +1545,7 @@ void loadCourses(string filePath, BinarySearchTree* bst) {
  *
  * @param  course containing the course info
  */
-void displayCourse(Course course) {
+void displayCourse(const Course& course) {
     // Output data of given course
     cout << endl << course.courseNum << ", " << course.title << endl;
     // If the course prereq vector variable is not empty
@@ -261,6 +1559,65 @@ void displayCourse(Course course) {
     return;
 }
 
+/**
+ * Time looking up every course in a shuffled order in the tree and in
+ * the frozen index, then in the index again copying each course out
+ * as Search does
+ *
+ * @param bst The tree holding the catalog
+ * @param index The index built from it
+ * @param rounds Passes over the whole catalog
+ */
+void benchmarkCourseIndex(BinarySearchTree* bst, CourseIndex& index, unsigned int rounds) {
+    vector<string> courseNums;
+    for (Course& course : index.Export()) {
+        courseNums.push_back(course.courseNum);
+    }
+    if (courseNums.empty()) {
+        cout << "Load a course file first." << endl;
+        return;
+    }
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = courseNums.size() - 1; i > 0; i--) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        swap(courseNums[i], courseNums[state % (i + 1)]);
+    }
+
+    size_t lookups = courseNums.size() * rounds;
+    size_t found = 0;
+    auto start = chrono::steady_clock::now();
+    for (unsigned int round = 0; round < rounds; round++) {
+        for (string& courseNum : courseNums) {
+            found += bst->Find(courseNum) != nullptr;
+        }
+    }
+    auto end = chrono::steady_clock::now();
+    double treeNs = chrono::duration<double, nano>(end - start).count() / lookups;
+
+    start = chrono::steady_clock::now();
+    for (unsigned int round = 0; round < rounds; round++) {
+        for (string& courseNum : courseNums) {
+            found += index.Find(courseNum) != nullptr;
+        }
+    }
+    end = chrono::steady_clock::now();
+    double indexNs = chrono::duration<double, nano>(end - start).count() / lookups;
+
+    start = chrono::steady_clock::now();
+    for (unsigned int round = 0; round < rounds; round++) {
+        for (string& courseNum : courseNums) {
+            found += !index.Search(courseNum).courseNum.empty();
+        }
+    }
+    end = chrono::steady_clock::now();
+    double copyNs = chrono::duration<double, nano>(end - start).count() / lookups;
+
+    cout << courseNums.size() << " courses: tree find " << treeNs << " ns | index find " << indexNs
+            << " ns | index search with copy " << copyNs << " ns | " << found << " found" << endl;
+}
+
 /**
  * Simple C function to convert a string to a double
  * after stripping out unwanted char
@@ -283,11 +1640,18 @@ int main(int argc, char* argv[]) {
     string searchNum;
     string filePath;
 
-    // Define a binary search tree to hold all courses
+    // Define a binary search tree to hold all courses, balanced since
+    // course files come sorted by course number
     BinarySearchTree* bst;
-    bst = new BinarySearchTree();
-    // Create empty course
-    Course course;
+    bst = new BinarySearchTree(true);
+
+    // and a frozen index of it for lookups, rebuilt after every load
+    CourseIndex index;
+    // and a radix tree over the course numbers for prefix searches,
+    // pointing at the courses in the index and rebuilt along with it
+    RadixTree<const Course*> courseNums;
+    // Course found by a lookup, left in place in the index
+    const Course* found;
 
     string input;
     int choice = 0;
@@ -296,6 +1660,9 @@ int main(int argc, char* argv[]) {
         cout << "  1. Load Data Structure" << endl;
         cout << "  2. Print Course List" << endl;
         cout << "  3. Print Course" << endl;
+        cout << "  4. Print Course List by Page" << endl;
+        cout << "  5. Benchmark Course Lookups" << endl;
+        cout << "  6. Find Courses by Prefix" << endl;
         cout << "  9. Exit" << endl;
         cout << "What would you like to do? ";
         getline(cin, input);
@@ -327,6 +1694,11 @@ int main(int argc, char* argv[]) {
 
                 // Call the loadCourses function given the filepath name and passing the tree structure
                 loadCourses(filePath, bst);
+                index.Build(bst);
+                courseNums.Clear();
+                for (const Course* loaded : index.Courses()) {
+                    courseNums.Insert(loaded->courseNum, loaded);
+                }
 
                 break;
 
@@ -349,12 +1721,12 @@ int main(int argc, char* argv[]) {
                 // One liner to convert each character in input string to uppercase for even comparison since all data is uppercase
                 for (int i = 0; i < searchNum.length(); i++) { searchNum.at(i) = toupper(searchNum.at(i)); }
 
-                // Call search function on binary search tree to find the course with searchNum as its course number
-                course = bst->Search(searchNum);
+                // Call find function on the frozen index to find the course with searchNum as its course number
+                found = index.Find(searchNum);
 
-                // If course is not empty (meaning the course was found), display data
-                if (!course.courseNum.empty()) {
-                    displayCourse(course);
+                // If course is not null (meaning the course was found), display it in place
+                if (found != nullptr) {
+                    displayCourse(*found);
                 }
                 // Else, course not found, output error
                 else {
@@ -363,11 +1735,62 @@ int main(int argc, char* argv[]) {
 
                 break;
 
+            case 4: {
+                // Clear screen
+                system("CLS");
+
+                // Show ten courses at a time, any page can be jumped to by number
+                cout << "Course List:" << endl << endl;
+                unsigned int pages = (bst->Size() + 9) / 10;
+                unsigned int pageNumber = 1;
+                while (pageNumber >= 1 && pageNumber <= pages) {
+                    vector<Course> page = bst->PageAt(pageNumber - 1, 10);
+                    for (Course& pageCourse : page) {
+                        cout << pageCourse.courseNum << ", " << pageCourse.title << endl;
+                    }
+                    cout << "Page " << pageNumber << " of " << pages << endl;
+
+                    cout << "Press Enter for the next page, a page number to jump to it or q to stop: ";
+                    getline(cin, input);
+                    if (input.empty()) {
+                        pageNumber++;
+                    } else {
+                        pageNumber = (unsigned int) atoi(input.c_str());
+                    }
+                }
+                cout << endl;
+
+                break;
+            }
+
+            case 5:
+                benchmarkCourseIndex(bst, index, 20);
+                break;
+
+            case 6: {
+                // List every course whose number starts with the input, e.g. CSCI3
+                cout << "Please enter the start of the course number: ";
+                getline(cin, searchNum);
+                transform(searchNum.begin(), searchNum.end(), searchNum.begin(), [](unsigned char c) {
+                    return (char) toupper(c);
+                });
+
+                vector<const Course*> matches = courseNums.WithPrefix(searchNum);
+                for (const Course* match : matches) {
+                    cout << match->courseNum << ", " << match->title << endl;
+                }
+                cout << matches.size() << " courses starting with " << searchNum << endl;
+
+                break;
+            }
+
             default:
                 system("CLS");
                 cout << input << " is not a valid option." << endl;
         }
     }
+    delete bst;
+
     cout << "Thank you for using the course planner!" << endl;
     return 0;
 }